@@ -0,0 +1,128 @@
+#ifndef HQP_BATCH_HPP
+#define HQP_BATCH_HPP
+
+#include <array>
+#include <Eigen/Dense>
+
+namespace hqp {
+
+/**
+ * @brief Solves `Lanes` hierarchies of the same shape at once, one per SIMD lane.
+ *
+ * Every scalar of the problem and of the solver state is stored as a packet of `Lanes` doubles (structure of arrays),
+ * so each arithmetic operation of the solve processes all the lanes with vector instructions. The active-set search
+ * is the one of HierarchicalQP: per level, activate the most violated row of the levels solved so far, else release
+ * the row with the most wrong-signed dual, else lock the strongly active rows and move on. Its decisions are made
+ * per lane with masks; a lane that converged on a level idles until the others do.
+ *
+ * The active rows of a level are orthogonalized against the levels above with Gram-Schmidt and solved in the least-
+ * squares sense through their normal equations, without pivoting. This suits small, well-scaled problems such as
+ * robot IK stacks; use HierarchicalQP for large or badly conditioned ones.
+ *
+ * The solution of every lane is the minimum-norm one of its hierarchy, as a freshly constructed HierarchicalQP would
+ * return. The metric is the identity. Like HierarchicalQP, each lane is warm-started from the active set of its
+ * previous solve.
+ *
+ * @tparam Lanes Number of problems solved at once, a multiple of the SIMD width (e.g. 4, 8 or 16)
+ * @tparam ROWS  Number of constraints of every problem
+ * @tparam COLS  Number of variables of every problem
+ * @tparam LEVS  Number of levels of every problem
+ */
+template<int Lanes, int ROWS, int COLS, int LEVS>
+class BatchedHierarchicalQP {
+    static_assert(Lanes > 0 && ROWS > 0 && COLS > 0 && LEVS > 0, "Batched problems must have a fixed positive size");
+
+  public:
+    /** One value per lane. */
+    using Pack = Eigen::Array<double, Lanes, 1>;
+
+  private:
+    using Index = Eigen::Array<int, Lanes, 1>;
+    using Mask  = Eigen::Array<bool, Lanes, 1>;
+
+    /** Level breaks shared by every lane. */
+    std::array<int, LEVS> breaks_;
+    /** Level of each row. */
+    std::array<int, ROWS> level_;
+    std::array<std::array<Pack, COLS>, ROWS> matrix_;
+    std::array<Pack, ROWS> lower_;
+    std::array<Pack, ROWS> upper_;
+    /** Active flags of each row, 1 or 0 in each lane. */
+    std::array<Pack, ROWS> activeLow_;
+    std::array<Pack, ROWS> activeUp_;
+    /** Rows that stay active for the rest of the solve: equalities and rows locked by a level. */
+    std::array<Pack, ROWS> locked_;
+    /** Norm of each row, to make rank decisions relative to it. */
+    std::array<Pack, ROWS> norms_;
+
+    /** Orthonormal direction added by each active row, zero for inactive rows and rows dependent on previous ones. */
+    std::array<std::array<Pack, COLS>, ROWS> directions_;
+    /** Components of the projected active rows along the directions of their level: R(j, i) for rows j <= i. */
+    std::array<std::array<Pack, ROWS>, ROWS> r_;
+    /** Cholesky factor of R R^T over the rows of each level, identity on the rows adding no direction. */
+    std::array<std::array<Pack, ROWS>, ROWS> cholesky_;
+    /** Least-squares residual of the active rows, which is their dual on their own level. */
+    std::array<Pack, ROWS> residual_;
+    /** Duals of the active rows for the level being solved. */
+    std::array<Pack, ROWS> dual_;
+    /** Primal before each level; the last one is the solution. */
+    std::array<std::array<Pack, COLS>, LEVS + 1> primals_;
+    /** Number of active-set changes of each lane in the last solve. */
+    Index changes_;
+
+    /** First row of a level. */
+    int level_start(int k) const;
+    /** Solves the active rows of the levels from `level` on, starting from the primal before `level`. */
+    void factorize_from(int level);
+    /** Solves L L^T y = rhs in place over the rows of level k. */
+    void cholesky_solve(int k, std::array<Pack, ROWS>& rhs) const;
+    /** Computes the duals of the active rows of the levels up to h for the objective of level h. */
+    void dual_update(int h);
+
+  public:
+    /** Tolerance for convergence and numerical stability. */
+    double tolerance = 1e-9;
+    /** Violation, in units of tolerance, a constraint must exceed to be activated. */
+    double activationMargin = 1.0;
+    /** Wrong-signed dual, in units of tolerance, a constraint must exceed to be deactivated. */
+    double deactivationMargin = 10.0;
+    /** Maximum number of active-set changes of a lane in a solve. */
+    int maxChanges = 500;
+
+    /**
+     * @brief Constructs the solver for hierarchies with the given level breaks.
+     * @param breaks Indices marking the end of each level, shared by every lane; the last one must be ROWS
+     */
+    explicit BatchedHierarchicalQP(const Eigen::Vector<int, LEVS>& breaks);
+
+    /**
+     * @brief Sets the problem of one lane.
+     *
+     * The problem data of all the lanes can also be written in place through matrix(), lower() and upper().
+     */
+    template<typename MatrixType, typename LowerType, typename UpperType>
+    void set_problem(int lane, const MatrixType& matrix, const LowerType& lower, const UpperType& upper);
+
+    /** Entry (row, col) of the matrix of every lane. */
+    Pack& matrix(int row, int col);
+    /** Lower bound of a row in every lane. */
+    Pack& lower(int row);
+    /** Upper bound of a row in every lane. */
+    Pack& upper(int row);
+
+    /** Solves the problems of every lane. Throws std::invalid_argument if a lower bound exceeds its upper bound. */
+    void solve();
+
+    /** Solution of one lane after solve(). */
+    Eigen::Vector<double, COLS> get_primal(int lane) const;
+    /** Variable `col` of the solution of every lane after solve(). */
+    const Pack& primal(int col) const;
+    /** Number of active-set changes of one lane in the last solve. */
+    int changes(int lane) const;
+};
+
+}  // namespace hqp
+
+#include "batch.tpp"
+
+#endif  // HQP_BATCH_HPP
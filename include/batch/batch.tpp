@@ -0,0 +1,373 @@
+#ifndef HQP_BATCH_TPP
+#define HQP_BATCH_TPP
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace hqp {
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::BatchedHierarchicalQP(const Eigen::Vector<int, LEVS>& breaks) {
+    for (int prev = 0, k = 0; k < LEVS; ++k) {
+        if (breaks(k) < prev) {
+            throw std::invalid_argument("breaks must be non-decreasing");
+        }
+        breaks_[k] = prev = breaks(k);
+    }
+    if (breaks_[LEVS - 1] != ROWS) {
+        throw std::invalid_argument("The last break must equal the number of rows");
+    }
+    for (int start = 0, k = 0; k < LEVS; ++k) {
+        std::fill(level_.begin() + start, level_.begin() + breaks_[k], k);
+        start = breaks_[k];
+    }
+
+    for (int row = 0; row < ROWS; ++row) {
+        for (int col = 0; col < COLS; ++col) {
+            matrix_[row][col].setZero();
+        }
+        lower_[row].setZero();
+        upper_[row].setZero();
+        activeLow_[row].setZero();
+        activeUp_[row].setZero();
+    }
+    for (auto& primal : primals_) {
+        for (auto& value : primal) {
+            value.setZero();
+        }
+    }
+    changes_.setZero();
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+template<typename MatrixType, typename LowerType, typename UpperType>
+void BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::set_problem(int lane,
+                                                                 const MatrixType& matrix,
+                                                                 const LowerType& lower,
+                                                                 const UpperType& upper) {
+    if (lane < 0 || lane >= Lanes) {
+        throw std::invalid_argument("Lane out of range");
+    }
+    if (matrix.rows() != ROWS || matrix.cols() != COLS || lower.size() != ROWS || upper.size() != ROWS) {
+        throw std::invalid_argument("Problem size must match the batch");
+    }
+    for (int row = 0; row < ROWS; ++row) {
+        for (int col = 0; col < COLS; ++col) {
+            matrix_[row][col](lane) = matrix(row, col);
+        }
+        lower_[row](lane) = lower(row);
+        upper_[row](lane) = upper(row);
+    }
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+typename BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::Pack&
+  BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::matrix(int row, int col) {
+    return matrix_[row][col];
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+typename BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::Pack&
+  BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::lower(int row) {
+    return lower_[row];
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+typename BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::Pack&
+  BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::upper(int row) {
+    return upper_[row];
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+Eigen::Vector<double, COLS> BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::get_primal(int lane) const {
+    Eigen::Vector<double, COLS> primal;
+    for (int col = 0; col < COLS; ++col) {
+        primal(col) = primals_[LEVS][col](lane);
+    }
+    return primal;
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+const typename BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::Pack&
+  BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::primal(int col) const {
+    return primals_[LEVS][col];
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+int BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::changes(int lane) const {
+    return changes_(lane);
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+int BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::level_start(int k) const {
+    return k == 0 ? 0 : breaks_[k - 1];
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+void BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::factorize_from(int level) {
+    std::array<Pack, ROWS> rhs;
+    for (int k = level; k < LEVS; ++k) {
+        int start = level_start(k), end = breaks_[k];
+        auto& x   = primals_[k + 1];
+        x         = primals_[k];
+
+        // Gram-Schmidt, twice for orthogonality, of the active rows against the directions of the rows before them
+        for (int i = start; i < end; ++i) {
+            Pack active = activeLow_[i].max(activeUp_[i]);
+            std::array<Pack, COLS> row;
+            for (int col = 0; col < COLS; ++col) {
+                row[col] = matrix_[i][col] * active;
+            }
+            for (int j = start; j <= i; ++j) {
+                r_[j][i].setZero();
+            }
+            for (int pass = 0; pass < 2; ++pass) {
+                for (int j = 0; j < i; ++j) {
+                    Pack coefficient = Pack::Zero();
+                    for (int col = 0; col < COLS; ++col) {
+                        coefficient += directions_[j][col] * row[col];
+                    }
+                    for (int col = 0; col < COLS; ++col) {
+                        row[col] -= coefficient * directions_[j][col];
+                    }
+                    if (j >= start) {
+                        r_[j][i] += coefficient;
+                    }
+                }
+            }
+
+            // A row whose projection is small relative to the row itself adds no direction
+            Pack norm = Pack::Zero();
+            for (int col = 0; col < COLS; ++col) {
+                norm += row[col] * row[col];
+            }
+            norm          = norm.sqrt();
+            Mask accepted = (active > 0) && (norm > tolerance * norms_[i]);
+            Pack scale    = accepted.select(norm.inverse(), 0.0);
+            for (int col = 0; col < COLS; ++col) {
+                directions_[i][col] = row[col] * scale;
+            }
+            r_[i][i] = accepted.select(norm, 0.0);
+
+            Pack value = Pack::Zero();
+            for (int col = 0; col < COLS; ++col) {
+                value += matrix_[i][col] * x[col];
+            }
+            rhs[i] = active * ((activeUp_[i] > 0).select(upper_[i], lower_[i]) - value);
+        }
+
+        // Least squares over the directions of the level: R R^T d = R e, with R R^T = L L^T
+        for (int j = start; j < end; ++j) {
+            for (int l = start; l <= j; ++l) {
+                Pack gram = Pack::Zero();
+                for (int i = j; i < end; ++i) {
+                    gram += r_[j][i] * r_[l][i];
+                }
+                for (int p = start; p < l; ++p) {
+                    gram -= cholesky_[j][p] * cholesky_[l][p];
+                }
+                if (l < j) {
+                    cholesky_[j][l] = gram / cholesky_[l][l];
+                } else {
+                    gram += (r_[j][j] > 0).select(0.0, Pack::Ones());
+                    cholesky_[j][j] = gram.max(std::numeric_limits<double>::min()).sqrt();
+                }
+            }
+        }
+        std::array<Pack, ROWS> step;
+        for (int j = start; j < end; ++j) {
+            step[j].setZero();
+            for (int i = j; i < end; ++i) {
+                step[j] += r_[j][i] * rhs[i];
+            }
+        }
+        cholesky_solve(k, step);
+
+        for (int j = start; j < end; ++j) {
+            for (int col = 0; col < COLS; ++col) {
+                x[col] += step[j] * directions_[j][col];
+            }
+        }
+        for (int i = start; i < end; ++i) {
+            residual_[i] = rhs[i];
+            for (int j = start; j <= i; ++j) {
+                residual_[i] -= r_[j][i] * step[j];
+            }
+        }
+    }
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+void BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::cholesky_solve(int k, std::array<Pack, ROWS>& rhs) const {
+    int start = level_start(k), end = breaks_[k];
+    for (int j = start; j < end; ++j) {
+        for (int p = start; p < j; ++p) {
+            rhs[j] -= cholesky_[j][p] * rhs[p];
+        }
+        rhs[j] /= cholesky_[j][j];
+    }
+    for (int j = end - 1; j >= start; --j) {
+        for (int p = j + 1; p < end; ++p) {
+            rhs[j] -= cholesky_[p][j] * rhs[p];
+        }
+        rhs[j] /= cholesky_[j][j];
+    }
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+void BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::dual_update(int h) {
+    std::array<Pack, COLS> tau;
+    for (auto& value : tau) {
+        value.setZero();
+    }
+    auto accumulate = [&](int start, int end) {
+        for (int i = start; i < end; ++i) {
+            for (int col = 0; col < COLS; ++col) {
+                tau[col] += matrix_[i][col] * dual_[i];
+            }
+        }
+    };
+
+    // The residual of the level, then the duals that keep each level above at its optimum: R lambda = -Q^T tau
+    for (int i = level_start(h); i < breaks_[h]; ++i) {
+        dual_[i] = residual_[i];
+    }
+    accumulate(level_start(h), breaks_[h]);
+    std::array<Pack, ROWS> force;
+    for (int k = h - 1; k >= 0; --k) {
+        int start = level_start(k), end = breaks_[k];
+        for (int j = start; j < end; ++j) {
+            force[j].setZero();
+            for (int col = 0; col < COLS; ++col) {
+                force[j] -= directions_[j][col] * tau[col];
+            }
+        }
+        cholesky_solve(k, force);
+        for (int i = start; i < end; ++i) {
+            dual_[i].setZero();
+            for (int j = start; j <= i; ++j) {
+                dual_[i] += r_[j][i] * force[j];
+            }
+        }
+        accumulate(start, end);
+    }
+}
+
+
+template<int Lanes, int ROWS, int COLS, int LEVS>
+void BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS>::solve() {
+    const double infinity = std::numeric_limits<double>::infinity();
+    for (int row = 0; row < ROWS; ++row) {
+        if ((lower_[row] > upper_[row]).any()) {
+            throw std::invalid_argument("Lower bounds must be <= upper bounds");
+        }
+        Mask equality   = lower_[row] == upper_[row];
+        activeLow_[row] = equality.select(1.0, activeLow_[row]);
+        activeUp_[row]  = (activeLow_[row] > 0 && !equality).select(0.0, equality.select(1.0, activeUp_[row]));
+        locked_[row]    = equality.template cast<double>();
+
+        norms_[row].setZero();
+        for (int col = 0; col < COLS; ++col) {
+            norms_[row] += matrix_[row][col] * matrix_[row][col];
+        }
+        norms_[row] = norms_[row].sqrt();
+    }
+    changes_.setZero();
+    for (auto& value : primals_[0]) {
+        value.setZero();
+    }
+    factorize_from(0);
+
+    double activation   = activationMargin * tolerance;
+    double deactivation = deactivationMargin * tolerance;
+    const auto& x       = primals_[LEVS];
+    std::array<Pack, ROWS> score;
+    for (int h = 0; h < LEVS; ++h) {
+        int rows     = breaks_[h];
+        Mask running = changes_ < maxChanges;
+        while (running.any()) {
+            // Most violated inactive bound of the levels up to h
+            Pack violation = Pack::Constant(-infinity);
+            Index added    = Index::Zero();
+            Pack addedLow  = Pack::Zero();
+            for (int i = 0; i < rows; ++i) {
+                Pack value = Pack::Zero();
+                for (int col = 0; col < COLS; ++col) {
+                    value += matrix_[i][col] * x[col];
+                }
+                Pack up     = (activeUp_[i] > 0).select(-infinity, value - upper_[i]);
+                Mask better  = up > violation;
+                violation   = better.select(up, violation);
+                added       = better.select(Index::Constant(i), added);
+                addedLow    = better.select(0.0, addedLow);
+                Pack low    = (activeLow_[i] > 0).select(-infinity, lower_[i] - value);
+                better      = low > violation;
+                violation   = better.select(low, violation);
+                added       = better.select(Index::Constant(i), added);
+                addedLow    = better.select(1.0, addedLow);
+            }
+            Mask activate = running && violation > activation;
+
+            // Lanes with nothing to add release the active row with the most wrong-signed dual, or lock and stop
+            Mask release   = Mask::Constant(false);
+            Index released = Index::Zero();
+            if ((running && !activate).any()) {
+                dual_update(h);
+                Pack worst = Pack::Constant(-infinity);
+                for (int i = 0; i < rows; ++i) {
+                    score[i] = (activeUp_[i] > 0).select(dual_[i], -dual_[i]);
+                    Pack candidate =
+                      (locked_[i] > 0 || activeLow_[i].max(activeUp_[i]) == 0).select(-infinity, score[i]);
+                    Mask better = candidate > worst;
+                    worst       = better.select(candidate, worst);
+                    released    = better.select(Index::Constant(i), released);
+                }
+                release        = running && !activate && worst > deactivation;
+                Mask converged = running && !activate && !release;
+                for (int i = 0; i < rows; ++i) {
+                    Mask strong = converged && activeLow_[i].max(activeUp_[i]) > 0 && score[i] < -tolerance;
+                    locked_[i]  = strong.select(1.0, locked_[i]);
+                }
+                running = running && !converged;
+            }
+
+            int first = LEVS;
+            for (int lane = 0; lane < Lanes; ++lane) {
+                if (activate(lane)) {
+                    first = std::min(first, level_[added(lane)]);
+                }
+                if (release(lane)) {
+                    first = std::min(first, level_[released(lane)]);
+                }
+            }
+            if (first == LEVS) {
+                continue;
+            }
+            for (int i = 0; i < rows; ++i) {
+                Mask add       = activate && added == i;
+                Mask remove    = release && released == i;
+                activeLow_[i]  = remove.select(0.0, (add && addedLow > 0).select(1.0, activeLow_[i]));
+                activeUp_[i]   = remove.select(0.0, (add && addedLow == 0).select(1.0, activeUp_[i]));
+            }
+            changes_ += activate.template cast<int>() + release.template cast<int>();
+            running = running && changes_ < maxChanges;
+            factorize_from(first);
+        }
+    }
+}
+
+}  // namespace hqp
+
+#endif  // HQP_BATCH_TPP
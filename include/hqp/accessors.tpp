@@ -28,6 +28,29 @@ double HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::get_level_
 }
 
 
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::update_costs(int levels) {
+    for (int k = 0; k < levels; ++k) {
+        costs_(k) = get_level_cost(k);
+    }
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+int HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::compare_costs(
+  int levels, const Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::AutoAlign, MaxLevels, 1>& reference) const {
+    for (int k = 0; k < levels; ++k) {
+        if (costs_(k) < reference(k) - tolerance) {
+            return -1;
+        }
+        if (costs_(k) > reference(k) + tolerance) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
 template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
 const Eigen::Matrix<double, COLS, 1, Eigen::AutoAlign, MaxCols, 1>&
   HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::get_primal() {
@@ -65,19 +88,21 @@ std::tuple<Eigen::Vector<double, ROWS>, Eigen::Vector<double, ROWS>>
 
 
 template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
-void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_metric(const Eigen::MatrixXd& metric) {
+template<typename MetricType>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_metric(const MetricType& metric) {
     if (metric.rows() != metric.cols() || metric.rows() != col_) {
         throw std::invalid_argument("Metric must be a square matrix of size " + std::to_string(col_));
     }
     if (!metric.isApprox(metric.transpose(), tolerance)) {
         throw std::invalid_argument("Metric must be symmetric");
     }
-    Eigen::LLT<Eigen::MatrixXd> lltOf(metric);
-    if (lltOf.info() == Eigen::NumericalIssue) {
+    metricLlt_.compute(metric);
+    if (metricLlt_.info() == Eigen::NumericalIssue) {
         throw std::invalid_argument("Metric must be positive definite");
     }
     cholMetric_.setIdentity();
-    lltOf.matrixU().solveInPlace<Eigen::OnTheLeft>(cholMetric_);
+    metricLlt_.matrixU().template solveInPlace<Eigen::OnTheLeft>(cholMetric_);
+    diagonalMetric_ = false;
 
     // Invalidate caches when metric changes
     primalValid_ = false;
@@ -85,6 +110,79 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_metric(c
 }
 
 
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+template<typename DiagonalType>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_metric_diagonal(const DiagonalType& diagonal) {
+    if (diagonal.size() != col_) {
+        throw std::invalid_argument("Metric diagonal must be of size " + std::to_string(col_));
+    }
+    if (!(diagonal.array() > 0).all()) {
+        throw std::invalid_argument("Metric must be positive definite");
+    }
+    cholMetric_.setZero();
+    cholMetric_.diagonal() = diagonal.array().rsqrt().matrix();
+    diagonalMetric_        = true;
+
+    // Invalidate caches when metric changes
+    primalValid_ = false;
+    slacksValid_ = false;
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+template<typename FactorType>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_metric_factor(const FactorType& factor,
+                                                                                      bool isInverse) {
+    if (factor.rows() != factor.cols() || factor.rows() != col_) {
+        throw std::invalid_argument("Metric factor must be a square matrix of size " + std::to_string(col_));
+    }
+    if (isInverse) {
+        cholMetric_ = factor;
+    } else {
+        if (!(factor.diagonal().array() > 0).all()) {
+            throw std::invalid_argument("Metric factor must have a positive diagonal");
+        }
+        cholMetric_.setIdentity();
+        factor.template triangularView<Eigen::Upper>().template solveInPlace<Eigen::OnTheLeft>(cholMetric_);
+    }
+    diagonalMetric_ = false;
+
+    // Invalidate caches when metric changes
+    primalValid_ = false;
+    slacksValid_ = false;
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_factorization(int level,
+                                                                                      Factorization factorization) {
+    if (level < 0) {
+        throw std::invalid_argument("Level must be non-negative");
+    }
+    if (level >= static_cast<int>(factorizations_.size())) {
+        factorizations_.resize(level + 1, defaultFactorization_);
+    }
+    factorizations_[level] = factorization;
+    primalValid_           = false;
+    slacksValid_           = false;
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_factorization(Factorization factorization) {
+    factorizations_.clear();
+    defaultFactorization_ = factorization;
+    primalValid_          = false;
+    slacksValid_          = false;
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_recorder(ProblemRecorder* recorder) {
+    recorder_ = recorder;
+}
+
+
 template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
 template<typename MatrixType, typename LowerType, typename UpperType, typename BreaksType>
 void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_problem(const MatrixType& matrix,
@@ -132,6 +230,22 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_problem(
         }
     }
 
+    if (recorder_) {
+        int rows = matrix.rows();
+        recorder_->record({matrix,
+                           lower,
+                           upper,
+                           breaks,
+                           cholMetric_,
+                           diagonalMetric_,
+                           guess_,
+                           activeLowSet_.head(rows),
+                           activeUpSet_.head(rows),
+                           tolerance,
+                           activationMargin,
+                           deactivationMargin});
+    }
+
     matrix_ = matrix;
     lower_  = lower;
     upper_  = upper;
@@ -148,6 +262,9 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_problem(
     // Resize vectors to the number of levels
     dofs_.resize(lev_);
     ranks_.setZero(lev_);
+    costs_.resize(lev_);
+    entryCosts_.resize(lev_);
+    bestCosts_.resize(lev_);
     codMids_.resize(lev_);
     codRights_.resize(lev_);
     breaksFix_.resize(lev_);
@@ -158,24 +275,35 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::set_problem(
         codMids_[k].resizeLike(nullSpace_);
         codRights_[k].resizeLike(nullSpace_);
         level_.segment(start, dim).setConstant(k);
+        start = breaks(k);
+    }
+    sort_active_set();
+
+    primalValid_ = false;
+    slacksValid_ = false;
+}
+
 
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::sort_active_set() {
+    activeHash_ = 0;
+    for (int start = 0, k = 0; k < lev_; ++k) {
         breaksFix_(k) = breaksAct_(k) = start;
-        for (int row = start; row < breaks(k); ++row) {
+        for (int row = start; row < breaks_(k); ++row) {
+            // Activation swaps another row into this position, so read the flag first
+            bool isEquality = equalitySet_(row);
             if (activeLowSet_(row)) {
                 activate_constraint(row, true);
             } else if (activeUpSet_(row)) {
                 activate_constraint(row, false);
             }
-            if (equalitySet_(row)) {
-                lock_constraint(breaksAct_(level_(row)) - 1);
+            if (isEquality) {
+                lock_constraint(breaksAct_(k) - 1);
             }
         }
-
-        start = breaks(k);
+        start = breaks_(k);
     }
-
-    primalValid_ = false;
-    slacksValid_ = false;
 }
 
 }  // namespace hqp
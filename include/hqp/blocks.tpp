@@ -0,0 +1,177 @@
+#ifndef HQP_BLOCKS_TPP
+#define HQP_BLOCKS_TPP
+
+#include <algorithm>
+
+namespace hqp {
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+bool HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::split_blocks() {
+    int m = matrix_.rows();
+    int n = col_;
+
+    // Connected components of the graph linking each row to the columns it reads, and the columns the metric couples
+    blockParent_.resize(n + m);
+    for (int node = 0; node < n + m; ++node) blockParent_[node] = node;
+    auto find = [this](int node) {
+        while (blockParent_[node] != node) {
+            node = blockParent_[node] = blockParent_[blockParent_[node]];
+        }
+        return node;
+    };
+    auto join = [&find, this](int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) {
+            blockParent_[std::max(a, b)] = std::min(a, b);
+        }
+    };
+    for (int col = 0; col < n; ++col) {
+        for (int row = 0; row < m; ++row) {
+            if (matrix_(row, col) != 0) {
+                join(col, n + row);
+            }
+        }
+    }
+    if (!diagonalMetric_) {
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i < n; ++i) {
+                if (i != j && cholMetric_(i, j) != 0) {
+                    join(i, j);
+                }
+            }
+        }
+    }
+
+    // Number the components that hold a column by their first row; rows of zeros go to the first one
+    int count = 0;
+    blockOf_.assign(n + m, -1);
+    for (int row = 0; row < m; ++row) {
+        int root = find(n + row);
+        if (root < n && blockOf_[root] < 0) {
+            blockOf_[root] = count++;
+        }
+    }
+    if (count < 2) {
+        return false;
+    }
+    for (int node = 0; node < n + m; ++node) {
+        int root       = find(node);
+        blockOf_[node] = root < n ? blockOf_[root] : 0;
+    }
+
+    blockRows_.resize(count);
+    blockCols_.resize(count);
+    blockBreaks_.resize(count);
+    for (int b = 0; b < count; ++b) {
+        blockRows_[b].clear();
+        blockCols_[b].clear();
+        blockBreaks_[b].setZero(lev_);
+    }
+    for (int col = 0; col < n; ++col) {
+        if (blockOf_[col] >= 0) {
+            blockCols_[blockOf_[col]].push_back(col);
+        }
+    }
+    for (int row = 0; row < m; ++row) {
+        int b = blockOf_[n + row];
+        blockRows_[b].push_back(row);
+        ++blockBreaks_[b](level_(row));
+    }
+    for (int b = 0; b < count; ++b) {
+        for (int k = 1; k < lev_; ++k) {
+            blockBreaks_[b](k) += blockBreaks_[b](k - 1);
+        }
+    }
+    return true;
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::solve_blocks() {
+    int count = blockRows_.size();
+    if (static_cast<int>(blocks_.size()) > count) {
+        blocks_.erase(blocks_.begin() + count, blocks_.end());
+    }
+
+    // Every sub-hierarchy starts from the warm start and settings of the whole problem
+    for (int b = 0; b < count; ++b) {
+        const auto& rows = blockRows_[b];
+        const auto& cols = blockCols_[b];
+        int m            = rows.size();
+        int n            = cols.size();
+        if (b == static_cast<int>(blocks_.size())) {
+            blocks_.emplace_back(m, n);
+        } else if (blocks_[b].col_ != n || blocks_[b].perm_.size() != m) {
+            blocks_[b] = HierarchicalQP<>(m, n);
+        }
+
+        auto& block                 = blocks_[b];
+        block.tolerance             = tolerance;
+        block.activationMargin      = activationMargin;
+        block.deactivationMargin    = deactivationMargin;
+        block.factorizations_       = factorizations_;
+        block.defaultFactorization_ = defaultFactorization_;
+        block.diagonalMetric_       = diagonalMetric_;
+        if (diagonalMetric_) {
+            block.cholMetric_.setZero();
+            block.cholMetric_.diagonal() = cholMetric_.diagonal()(cols);
+        } else {
+            block.cholMetric_ = cholMetric_(cols, cols);
+        }
+        block.guess_        = guess_(cols);
+        block.activeLowSet_ = activeLowSet_(rows);
+        block.activeUpSet_  = activeUpSet_(rows);
+        for (int i = 0; i < m; ++i) block.perm_(i) = i;
+        block.set_problem(matrix_(rows, cols), lower_(rows), upper_(rows), blockBreaks_[b]);
+    }
+
+    std::atomic<int> next{0};
+    std::exception_ptr error;
+    std::mutex mutex;
+    auto work = [this, count, &next, &error, &mutex]() {
+        for (int b = next++; b < count; b = next++) {
+            try {
+                blocks_[b].get_primal();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int helper = 1; helper < std::min(threads, count); ++helper) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    // Variables that no row reaches keep their warm start
+    primal_ = guess_;
+    changes = cycles = 0;
+    for (int b = 0; b < count; ++b) {
+        const auto& block       = blocks_[b];
+        primal_(blockCols_[b])  = block.primal_;
+        changes                += block.changes;
+        cycles                 += block.cycles;
+        for (int i = 0; i < block.perm_.size(); ++i) {
+            int row            = blockRows_[b][block.perm_(i)];
+            activeLowSet_(row) = block.activeLowSet_(i);
+            activeUpSet_(row)  = block.activeUpSet_(i);
+        }
+    }
+    // A later solve of the whole problem, e.g. after a coupling metric, starts from this active set
+    sort_active_set();
+    blocks = count;
+}
+
+}  // namespace hqp
+
+#endif  // HQP_BLOCKS_TPP
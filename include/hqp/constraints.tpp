@@ -1,10 +1,13 @@
 #ifndef HQP_CONSTRAINTS_TPP
 #define HQP_CONSTRAINTS_TPP
 
+#include <algorithm>
+
 namespace hqp {
 
 template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
 void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::activate_constraint(int row, bool isLowerBound) {
+    activeHash_ ^= hash_constraint(row, isLowerBound);
     if (isLowerBound) {
         activeLowSet_(row) = true;
     } else {
@@ -22,8 +25,9 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::activate_con
 
 template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
 void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::deactivate_constraint(int row) {
-    activeLowSet_(row) = false;
-    activeUpSet_(row)  = false;
+    activeHash_        ^= hash_constraint(row, activeLowSet_(row));
+    activeLowSet_(row)  = false;
+    activeUpSet_(row)   = false;
 
     swap_constraints(--breaksAct_(level_(row)), row);
 }
@@ -53,10 +57,66 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::swap_constra
     std::swap(upper_(i), upper_(j));
     std::swap(dual_(i), dual_(j));
     std::swap(perm_(i), perm_(j));
+    std::swap(scales_(i), scales_(j));
+    std::swap(blocked_(i), blocked_(j));
     matrix_.row(i).swap(matrix_.row(j));
     codLefts_.row(i).swap(codLefts_.row(j));
 }
 
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+std::uint64_t HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::hash_constraint(int row,
+                                                                                            bool isLowerBound) const {
+    // splitmix64 finalizer on the original row index and bound side
+    std::uint64_t x = 2 * static_cast<std::uint64_t>(perm_(row)) + isLowerBound + 0x9e3779b97f4a7c15ULL;
+    x               = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x               = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+bool HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::is_cycling() {
+    for (int i = 0; i < historySize_; ++i) {
+        if (history_[i] == activeHash_) {
+            return true;
+        }
+    }
+    if (history_.size() > 0) {
+        history_[historyHead_] = activeHash_;
+        historyHead_           = (historyHead_ + 1) % history_.size();
+        historySize_           = std::min<int>(historySize_ + 1, history_.size());
+    }
+    return false;
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::rollback(int kept) {
+    int rows  = breaks_(lev_ - 1);
+    int level = lev_;
+    for (int i = kept; i < static_cast<int>(changeLog_.size()); ++i) {
+        int row = 0;
+        while (row < rows && perm_(row) != changeLog_[i] / 4) ++row;
+        level = std::min(level, level_(row));
+    }
+
+    decrement_from(level);
+    for (int i = static_cast<int>(changeLog_.size()) - 1; i >= kept; --i) {
+        int row = 0;
+        while (row < rows && perm_(row) != changeLog_[i] / 4) ++row;
+        if (changeLog_[i] & 2) {
+            deactivate_constraint(row);
+        } else {
+            activate_constraint(row, changeLog_[i] & 1);
+        }
+        ++changes;
+    }
+    increment_from(level);
+    changeLog_.resize(kept);
+}
+
 }  // namespace hqp
 
 #endif  // HQP_CONSTRAINTS_TPP
\ No newline at end of file
@@ -13,7 +13,13 @@ HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::HierarchicalQP(in
   , tau_(n)
   , inverse_(n, n)
   , cholMetric_(n, n)
+  , metricLlt_(n)
   , nullSpace_(n, n)
+  , qr_(n, m)
+  , pivotedQr_(n, m)
+  , rangeQr_(m, m)
+  , normalLdlt_(m)
+  , projected_(m, n)
   , activeLowSet_(m)
   , activeUpSet_(m)
   , equalitySet_(m)
@@ -26,11 +32,14 @@ HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::HierarchicalQP(in
   , slackUp_(m)
   , matrix_(m, n)
   , codLefts_(m, m)
-  , perm_(m) {
+  , perm_(m)
+  , scales_(m)
+  , blocked_(m) {
     guess_.setZero();
     cholMetric_.setIdentity();
     activeLowSet_.setZero();
     activeUpSet_.setZero();
+    blocked_.setZero();
     for (int i = 0; i < m; ++i) perm_(i) = i;
 }
 
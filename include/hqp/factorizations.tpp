@@ -0,0 +1,210 @@
+#ifndef HQP_FACTORIZATIONS_TPP
+#define HQP_FACTORIZATIONS_TPP
+
+#include <algorithm>
+#include <cmath>
+
+namespace hqp {
+
+// Every factorization of the active rows A of level k, projected onto the nullspace basis N of the levels above,
+// produces the same pieces:
+//   codRights_[k]   N V, with V orthogonal: its first ranks_(k) columns span the range, the others the nullspace
+//   codLefts_       Q, whose first ranks_(k) columns are orthonormal
+//   codMids_[k]     T, upper triangular of size ranks_(k)
+// such that A N V = Q [T 0; 0 0].
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::project_rows(int start,
+                                                                                 int rows,
+                                                                                 int dof,
+                                                                                 bool scaleOnly) {
+    if (scaleOnly) {
+        projected_.topLeftCorner(rows, dof).noalias() =
+          matrix_.middleRows(start, rows) * cholMetric_.diagonal().asDiagonal();
+    } else {
+        projected_.topLeftCorner(rows, dof).noalias() = matrix_.middleRows(start, rows) * nullSpace_.leftCols(dof);
+    }
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::factorize_cod(int k,
+                                                                                  int start,
+                                                                                  int n_rows,
+                                                                                  int dof,
+                                                                                  bool scaleOnly,
+                                                                                  double scale) {
+    auto factorize = [&]() {
+        if (scaleOnly) {
+            cod_.compute(matrix_.middleRows(start, n_rows) * cholMetric_.diagonal().asDiagonal());
+        } else {
+            cod_.compute(matrix_.middleRows(start, n_rows) * nullSpace_.leftCols(dof));
+        }
+    };
+    cod_.setThreshold(tolerance);
+    factorize();
+
+    // Rank decisions are relative to the unprojected rows: a block that (almost) lies in the span of the higher
+    // levels must not be inverted just because all of its projected pivots are equally small.
+    if (cod_.maxPivot() > 0 && cod_.maxPivot() < scale) {
+        int rank = cod_.rank();
+        cod_.setThreshold(tolerance * scale / cod_.maxPivot());
+        if (cod_.rank() != rank) {
+            factorize();
+        }
+    }
+    ranks_(k)   = cod_.rank();
+    int leftDof = dof - ranks_(k);
+
+    if (scaleOnly && leftDof > 0) {
+        codRights_[k].leftCols(dof).noalias() =
+          cholMetric_.diagonal().asDiagonal() * (cod_.colsPermutation() * cod_.matrixZ().transpose());
+    } else if (scaleOnly) {
+        codRights_[k].leftCols(dof).noalias() = cholMetric_ * cod_.colsPermutation();
+    } else if (leftDof > 0) {
+        // In this case matrixZ() is not the identity, so Eigen computes it and is not garbage
+        codRights_[k].leftCols(dof).noalias() =
+          nullSpace_.leftCols(dof) * cod_.colsPermutation() * cod_.matrixZ().transpose();
+    } else {
+        codRights_[k].leftCols(dof).noalias() = nullSpace_.leftCols(dof) * cod_.colsPermutation();
+    }
+    auto codLeft = codLefts_.block(start, 0, n_rows, n_rows);
+    codLeft.setIdentity();
+    cod_.householderQ().applyThisOnTheLeft(codLeft);
+
+    codMids_[k].topLeftCorner(ranks_(k), ranks_(k)).noalias() = cod_.matrixT().topLeftCorner(ranks_(k), ranks_(k));
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::factorize_pivoted_qr(int k,
+                                                                                         int start,
+                                                                                         int n_rows,
+                                                                                         int dof,
+                                                                                         bool scaleOnly,
+                                                                                         double scale) {
+    // (A N)^T P = V R, so A N V = P R^T: pivoting picks rows, and only the n_rows x rank range is left to triangularize
+    project_rows(start, n_rows, dof, scaleOnly);
+    pivotedQr_.setThreshold(tolerance);
+    pivotedQr_.compute(projected_.topLeftCorner(n_rows, dof).transpose());
+    if (pivotedQr_.maxPivot() > 0 && pivotedQr_.maxPivot() < scale) {
+        pivotedQr_.setThreshold(tolerance * scale / pivotedQr_.maxPivot());
+    }
+    int rank  = pivotedQr_.rank();
+    ranks_(k) = rank;
+
+    auto rights = codRights_[k].leftCols(dof);
+    if (scaleOnly) {
+        rights = cholMetric_;
+    } else {
+        rights = nullSpace_.leftCols(dof);
+    }
+    pivotedQr_.householderQ().applyThisOnTheRight(rights);
+
+    auto codLeft = codLefts_.block(start, 0, n_rows, n_rows);
+    codLeft.setIdentity();
+    if (rank > 0) {
+        rangeQr_.compute(
+          pivotedQr_.matrixQR().topRows(rank).template triangularView<Eigen::Upper>().transpose());
+        rangeQr_.householderQ().applyThisOnTheLeft(codLeft);
+        codMids_[k].topLeftCorner(rank, rank) = rangeQr_.matrixQR().topLeftCorner(rank, rank);
+    }
+    codLeft = pivotedQr_.colsPermutation() * codLeft;
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+bool HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::factorize_qr(int k,
+                                                                                 int start,
+                                                                                 int n_rows,
+                                                                                 int dof,
+                                                                                 bool scaleOnly,
+                                                                                 double scale) {
+    if (n_rows > dof) {
+        return false;
+    }
+
+    // (A N)^T = V [R; 0], so A N V = [R^T 0]: reversing the order of the range makes R^T upper triangular
+    project_rows(start, n_rows, dof, scaleOnly);
+    qr_.compute(projected_.topLeftCorner(n_rows, dof).transpose());
+    auto pivots = qr_.matrixQR().diagonal().head(n_rows).cwiseAbs();
+    if (!(pivots.minCoeff() > tolerance * std::max(pivots.maxCoeff(), scale))) {
+        return false;
+    }
+    ranks_(k) = n_rows;
+
+    auto rights = codRights_[k].leftCols(dof);
+    if (scaleOnly) {
+        rights = cholMetric_;
+    } else {
+        rights = nullSpace_.leftCols(dof);
+    }
+    qr_.householderQ().applyThisOnTheRight(rights);
+    rights.leftCols(n_rows).rowwise().reverseInPlace();
+
+    auto codLeft = codLefts_.block(start, 0, n_rows, n_rows);
+    codLeft.setIdentity();
+    codLeft.rowwise().reverseInPlace();
+
+    codMids_[k].topLeftCorner(n_rows, n_rows) = qr_.matrixQR().topLeftCorner(n_rows, n_rows).transpose().reverse();
+    return true;
+}
+
+
+template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
+bool HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::factorize_ldlt(int k,
+                                                                                   int start,
+                                                                                   int n_rows,
+                                                                                   int dof,
+                                                                                   bool scaleOnly,
+                                                                                   double scale) {
+    if (n_rows > dof) {
+        return false;
+    }
+    // The normal equations give the range only: a level leaving DOFs to the next ones needs the nullspace too
+    if (n_rows < dof && k < lev_ - 1) {
+        return factorize_qr(k, start, n_rows, dof, scaleOnly, scale);
+    }
+
+    // A N N^T A^T + r I = P^T L D L^T P, so V = (A N)^T P^T L^-T D^-1/2 has orthonormal columns up to r and
+    // A N V = P^T L D^1/2: reversing the order of the range makes it upper triangular
+    project_rows(start, n_rows, dof, scaleOnly);
+    auto projected        = projected_.topLeftCorner(n_rows, dof);
+    auto codLeft          = codLefts_.block(start, 0, n_rows, n_rows);
+    double regularization = tolerance * tolerance * scale * scale;
+    codLeft.noalias()     = projected * projected.transpose();
+    codLeft.diagonal().array() += regularization;
+    normalLdlt_.compute(codLeft);
+    auto pivots      = normalLdlt_.vectorD();
+    double threshold = tolerance * std::max(std::sqrt(std::max(pivots.maxCoeff(), 0.0)), scale);
+    if (!((pivots.array() - regularization) > threshold * threshold).all()) {
+        return false;
+    }
+    ranks_(k) = n_rows;
+
+    projected = normalLdlt_.transpositionsP() * projected;
+    normalLdlt_.matrixL().solveInPlace(projected);
+    projected = pivots.cwiseSqrt().cwiseInverse().asDiagonal() * projected;
+
+    auto range = codRights_[k].leftCols(n_rows);
+    if (scaleOnly) {
+        range.noalias() = cholMetric_.diagonal().asDiagonal() * projected.transpose();
+    } else {
+        range.noalias() = nullSpace_.leftCols(dof) * projected.transpose();
+    }
+    range.rowwise().reverseInPlace();
+
+    codLeft.setIdentity();
+    codLeft.rowwise().reverseInPlace();
+    codLeft = normalLdlt_.transpositionsP().transpose() * codLeft;
+
+    auto mid = codMids_[k].topLeftCorner(n_rows, n_rows);
+    mid      = normalLdlt_.matrixL();
+    mid      = mid * pivots.cwiseSqrt().asDiagonal();
+    mid.reverseInPlace();
+    return true;
+}
+
+}  // namespace hqp
+
+#endif  // HQP_FACTORIZATIONS_TPP
@@ -11,13 +11,66 @@
 #ifndef HQP_HIERARCHICALQP_HPP
 #define HQP_HIERARCHICALQP_HPP
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <tuple>
 #include <Eigen/Dense>
 
+/** Number of active sets remembered per level to detect cycling of the active-set search. */
+#ifndef HQP_ANTI_CYCLING_BUFFER_SIZE
+#define HQP_ANTI_CYCLING_BUFFER_SIZE 16
+#endif
+
 namespace hqp {
 
+/** Problem passed to set_problem(), together with the solver state it is solved from. */
+struct ProblemSnapshot {
+    Eigen::Ref<const Eigen::MatrixXd> matrix;
+    Eigen::Ref<const Eigen::VectorXd> lower;
+    Eigen::Ref<const Eigen::VectorXd> upper;
+    Eigen::Ref<const Eigen::VectorXi> breaks;
+    /** Inverse Cholesky factor of the metric; only its diagonal is meaningful if `diagonalMetric`. */
+    Eigen::Ref<const Eigen::MatrixXd> metricFactor;
+    bool diagonalMetric;
+    /** Warm start: previous primal and active flags, in the row order of `matrix`. */
+    Eigen::Ref<const Eigen::VectorXd> guess;
+    Eigen::Ref<const Eigen::Array<bool, Eigen::Dynamic, 1>> activeLow;
+    Eigen::Ref<const Eigen::Array<bool, Eigen::Dynamic, 1>> activeUp;
+    double tolerance;
+    double activationMargin;
+    double deactivationMargin;
+};
+
+
+/** Receives every problem set on a solver, e.g. to log it for offline replay. */
+struct ProblemRecorder {
+    virtual ~ProblemRecorder()                          = default;
+    virtual void record(const ProblemSnapshot& problem) = 0;
+};
+
+
+class LogReader;
+
+
+/** Factorization of the projected active rows of a level. */
+enum class Factorization {
+    /** Complete orthogonal decomposition: rank revealing, the default. */
+    COD,
+    /** Householder QR of the transposed rows with row pivoting: rank revealing, cheaper when rows are few. */
+    PivotedQR,
+    /** Householder QR of the transposed rows without pivoting, for levels of full row rank. */
+    QR,
+    /** LDLT of the regularized normal equations, for well-conditioned last levels of full row rank. */
+    LDLT
+};
+
+
 template<int MaxRows   = -1,
          int MaxCols   = -1,
          int MaxLevels = -1,
@@ -25,6 +78,10 @@ template<int MaxRows   = -1,
          int COLS      = Eigen::Dynamic,
          int LEVS      = Eigen::Dynamic>
 class HierarchicalQP {
+    friend class LogReader;
+    template<int, int, int, int, int, int>
+    friend class HierarchicalQP;
+
   private:
     /** Number of variables in the problem. */
     int col_;
@@ -44,11 +101,22 @@ class HierarchicalQP {
     Eigen::Matrix<double, COLS, COLS, Eigen::AutoAlign, MaxCols, MaxCols> inverse_;
     /** Cholesky metric used for stability. */
     Eigen::Matrix<double, COLS, COLS, Eigen::AutoAlign, MaxCols, MaxCols> cholMetric_;
+    /** Reusable Cholesky factorization of the metric to avoid heap allocation on metric updates. */
+    Eigen::LLT<Eigen::Matrix<double, COLS, COLS, Eigen::AutoAlign, MaxCols, MaxCols>> metricLlt_;
     /** Reusable nullspace matrix to avoid re-instantiation. */
     Eigen::Matrix<double, COLS, COLS, Eigen::AutoAlign, MaxCols, MaxCols> nullSpace_;
     /** Reusable COD decomposition to avoid repeated heap allocation. */
     Eigen::CompleteOrthogonalDecomposition<
       Eigen::Matrix<double, ROWS, COLS, Eigen::AutoAlign, MaxRows, MaxCols>> cod_;
+    /** Reusable QR decompositions of the transposed projected rows of a level. */
+    Eigen::HouseholderQR<Eigen::Matrix<double, COLS, ROWS, Eigen::AutoAlign, MaxCols, MaxRows>> qr_;
+    Eigen::ColPivHouseholderQR<Eigen::Matrix<double, COLS, ROWS, Eigen::AutoAlign, MaxCols, MaxRows>> pivotedQr_;
+    /** Reusable QR decomposition of the range of a level after pivoted QR. */
+    Eigen::HouseholderQR<Eigen::Matrix<double, ROWS, ROWS, Eigen::AutoAlign, MaxRows, MaxRows>> rangeQr_;
+    /** Reusable LDLT decomposition of the normal equations of a level. */
+    Eigen::LDLT<Eigen::Matrix<double, ROWS, ROWS, Eigen::AutoAlign, MaxRows, MaxRows>> normalLdlt_;
+    /** Active rows of a level projected onto its nullspace basis. */
+    Eigen::Matrix<double, ROWS, COLS, Eigen::AutoAlign, MaxRows, MaxCols> projected_;
 
     /** Index tracking the active task level. */
     int k_ = 0;
@@ -78,7 +146,40 @@ class HierarchicalQP {
     Eigen::Matrix<double, ROWS, ROWS, Eigen::AutoAlign, MaxRows, MaxRows> codLefts_;
     /** Row permutation tracking: perm_(i) = original row index of current row i. */
     Eigen::Matrix<int, ROWS, 1, Eigen::AutoAlign, MaxRows, 1> perm_;
+    /** Norm of each constraint row in the metric, used to scale rank decisions. */
+    Eigen::Matrix<double, ROWS, 1, Eigen::AutoAlign, MaxRows, 1> scales_;
+    /** Active constraints that closed a cycle, kept active until the search moves to the next level. */
+    Eigen::Array<bool, ROWS, 1, Eigen::AutoAlign, MaxRows, 1> blocked_;
+
+    /** Order-independent hash of the current active set. */
+    std::uint64_t activeHash_ = 0;
+    /** Hashes of the active sets visited while solving the current level. */
+    std::array<std::uint64_t, HQP_ANTI_CYCLING_BUFFER_SIZE> history_;
+    /** Number of valid entries in the history. */
+    int historySize_ = 0;
+    /** Next position to overwrite in the history. */
+    int historyHead_ = 0;
+    /** Active-set changes made while solving the current level: 4 * original row + 2 * activation + lower bound. */
+    std::vector<int> changeLog_;
+
+    /** Recorder notified on every set_problem(), if any. */
+    ProblemRecorder* recorder_ = nullptr;
 
+    /** Solvers of the independent sub-hierarchies of the last decomposed solve. */
+    std::vector<HierarchicalQP<>> blocks_;
+    /** Rows of each sub-hierarchy, in the current row order of the problem. */
+    std::vector<std::vector<int>> blockRows_;
+    /** Columns of each sub-hierarchy. */
+    std::vector<std::vector<int>> blockCols_;
+    /** Level breaks of each sub-hierarchy. */
+    std::vector<Eigen::VectorXi> blockBreaks_;
+    /** Union-find forest over the columns followed by the rows, each node pointing towards its smallest member. */
+    std::vector<int> blockParent_;
+    /** Sub-hierarchy of each column followed by each row, -1 for columns that no row reaches. */
+    std::vector<int> blockOf_;
+
+    /** Flag indicating if the metric is diagonal, so that cholMetric_ only scales columns. */
+    bool diagonalMetric_ = true;
     /** Flag indicating if slack variables are up-to-date. */
     bool slacksValid_ = false;
     /** Flag indicating if primal solution is up-to-date. */
@@ -98,9 +199,23 @@ class HierarchicalQP {
     Eigen::Matrix<int, Eigen::Dynamic, 1, Eigen::AutoAlign, MaxLevels, 1> breaksAct_;
     /** Index in sorted list of inactive constraints for each task level. */
     Eigen::Matrix<int, Eigen::Dynamic, 1, Eigen::AutoAlign, MaxLevels, 1> breaks_;
+    /** Cost of each level in the current state of the active-set search. */
+    Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::AutoAlign, MaxLevels, 1> costs_;
+    /** Cost of each level when the search of the current level started. */
+    Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::AutoAlign, MaxLevels, 1> entryCosts_;
+    /** Lexicographically smallest costs reached by the search of the current level. */
+    Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::AutoAlign, MaxLevels, 1> bestCosts_;
+    /** Factorization hint of each level; levels past the end use the default one. */
+    std::vector<Factorization> factorizations_;
+    /** Factorization of the levels without a hint of their own. */
+    Factorization defaultFactorization_ = Factorization::COD;
 
     /** Solves the overall HQP by combining tasks. */
     void solve();
+    /** Splits the problem into independent sub-hierarchies; returns false if it has less than two. */
+    bool split_blocks();
+    /** Solves the sub-hierarchies, possibly in parallel, and gathers their solutions and active sets. */
+    void solve_blocks();
     /** Handles equality constraint resolution. */
     void equality_hqp();
     /** Handles inequality constrained tasks. */
@@ -113,6 +228,16 @@ class HierarchicalQP {
     void increment_from(int level);
     /** Increment primal due to contribution of active constraints in level. */
     void increment_primal(int parent, int level);
+    /** Projects the active rows of a level onto its nullspace basis. */
+    void project_rows(int start, int rows, int dof, bool scaleOnly);
+    /** Factorizes the active rows of a level with a complete orthogonal decomposition. */
+    void factorize_cod(int level, int start, int rows, int dof, bool scaleOnly, double scale);
+    /** Factorizes the active rows of a level with row-pivoted QR. */
+    void factorize_pivoted_qr(int level, int start, int rows, int dof, bool scaleOnly, double scale);
+    /** Factorizes the active rows of a level with unpivoted QR; returns false if they are rank deficient. */
+    bool factorize_qr(int level, int start, int rows, int dof, bool scaleOnly, double scale);
+    /** Factorizes the active rows of a level through their normal equations; returns false if rank deficient. */
+    bool factorize_ldlt(int level, int start, int rows, int dof, bool scaleOnly, double scale);
     /** Locks a constraint at the specified row. */
     void lock_constraint(int row);
     /** Activates a constraint at the specified row, indicating whether it is a lower or upper bound. */
@@ -121,17 +246,45 @@ class HierarchicalQP {
     void deactivate_constraint(int row);
     /** Swaps two constraints at specified indices. */
     void swap_constraints(int i, int j);
+    /** Orders the rows of every level as locked equalities, active, inactive, following the active flags. */
+    void sort_active_set();
+    /** Hash contribution of a row being active on the given bound. */
+    std::uint64_t hash_constraint(int row, bool isLowerBound) const;
+    /** Records the current active set and returns true if it was already visited at this level. */
+    bool is_cycling();
     /** Computes the parent level for a given task level. */
     int get_parent(int level);
     /** Computes the squared constraint violation cost at a given level. */
     double get_level_cost(int k);
+    /** Updates the costs of the first `levels` levels. */
+    void update_costs(int levels);
+    /** Compares the costs of the first `levels` levels lexicographically with reference ones: -1, 0 or 1. */
+    int compare_costs(int levels,
+                      const Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::AutoAlign, MaxLevels, 1>& reference) const;
+    /** Undoes the logged changes of the current level past the first `kept` ones. */
+    void rollback(int kept);
 
 
   public:
     /** Tolerance for convergence and numerical stability. */
     double tolerance = 1e-9;
+    /** Violation, in units of tolerance, a constraint must exceed to be activated. */
+    double activationMargin = 1.0;
+    /** Wrong-signed dual, in units of tolerance, a constraint must exceed to be deactivated. */
+    double deactivationMargin = 10.0;
     /** Number of active-set changes in the last solve (activations + deactivations). */
     int changes = 0;
+    /** Number of active-set cycles detected in the last solve; the row closing each one stays active for its level. */
+    int cycles = 0;
+    /**
+     * Split the problem into sub-hierarchies over groups of variables that no row and no metric entry couple (e.g.
+     * the tasks of two arms, or masked tasks), and solve them independently. Allocates when the structure changes.
+     */
+    bool decompose = false;
+    /** Maximum number of threads solving the sub-hierarchies of a decomposed problem. */
+    int threads = 1;
+    /** Number of sub-hierarchies the last solve was split into, 0 if it was solved as a whole. */
+    int blocks = 0;
 
     /**
      * @brief Constructs the HierarchicalQP solver.
@@ -156,8 +309,55 @@ class HierarchicalQP {
     /**
      * @brief Sets the metric matrix used to define the quadratic cost.
      * @param metric The metric matrix that influences the solver's behavior.
+     *
+     * The metric must be symmetric positive definite. Its Cholesky factorization reuses storage owned by the solver,
+     * so updating the metric of a fixed-size problem every tick does not allocate.
      */
-    void set_metric(const Eigen::MatrixXd& metric);
+    template<typename MetricType>
+    void set_metric(const MetricType& metric);
+
+    /**
+     * @brief Sets a diagonal metric.
+     * @param diagonal The positive diagonal entries of the metric.
+     *
+     * O(n) update. The solver then scales columns instead of multiplying by a dense factor of the metric.
+     */
+    template<typename DiagonalType>
+    void set_metric_diagonal(const DiagonalType& diagonal);
+
+    /**
+     * @brief Sets the metric from an already computed Cholesky factor.
+     * @param factor    Upper triangular factor U with metric = U^T U (e.g. `LLT::matrixU()`), or its inverse
+     * @param isInverse Whether `factor` is the inverse factor U^-1
+     *
+     * Only the upper triangle of U is read. Passing U costs a triangular inversion, O(n^3 / 3), while passing U^-1
+     * is an O(n^2) copy that skips every check: any nonsingular W with metric^-1 = W W^T is accepted.
+     */
+    template<typename FactorType>
+    void set_metric_factor(const FactorType& factor, bool isInverse = false);
+
+    /**
+     * @brief Sets the factorization of a level.
+     * @param level         Level index
+     * @param factorization Factorization of the active rows of the level
+     *
+     * COD is always safe. QR and LDLT skip rank revelation and are only faster for levels known to be of full row
+     * rank: if the rows turn out rank deficient they fall back to COD. LDLT only provides the range of the level, so
+     * it is used for the last level, or a level consuming all the DOFs left, and replaced by QR elsewhere.
+     */
+    void set_factorization(int level, Factorization factorization);
+
+    /**
+     * @brief Sets the factorization of every level.
+     * @param factorization Factorization of the active rows of all the levels
+     */
+    void set_factorization(Factorization factorization);
+
+    /**
+     * @brief Attaches a recorder that receives every problem passed to set_problem().
+     * @param recorder The recorder (e.g. a LogWriter), or nullptr to stop recording. Must outlive the solver.
+     */
+    void set_recorder(ProblemRecorder* recorder);
 
     /**
      * @brief Stacks multiple tasks into a hierarchical QP problem.
@@ -227,4 +427,9 @@ HierarchicalQP(int, int) -> HierarchicalQP<>;
 
 #include "hqp.tpp"
 
+// Linking HQP::hqp_compiled: use its precompiled instantiations
+#ifdef HQP_COMPILED
+#include <hqp/extern.hpp>
+#endif
+
 #endif  // HQP_HIERARCHICALQP_HPP
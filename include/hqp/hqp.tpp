@@ -6,6 +6,8 @@
 #include "accessors.tpp"
 #include "constraints.tpp"
 #include "utilities.tpp"
+#include "factorizations.tpp"
 #include "solvers.tpp"
+#include "blocks.tpp"
 
 #endif  // HQP_HIERARCHICALQP_TPP
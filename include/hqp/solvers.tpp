@@ -1,12 +1,29 @@
 #ifndef HQP_SOLVERS_TPP
 #define HQP_SOLVERS_TPP
 
+#include <algorithm>
 #include <limits>
 
 namespace hqp {
 
 template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
 void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::solve() {
+    blocks = 0;
+    if (decompose && split_blocks()) {
+        solve_blocks();
+        guess_ = primal_;
+        return;
+    }
+
+    if (diagonalMetric_) {
+        scales_.noalias() = (matrix_ * cholMetric_.diagonal().asDiagonal()).rowwise().norm();
+    } else {
+        for (int row = 0; row < scales_.size(); ++row) {
+            force_.noalias() = cholMetric_.transpose() * matrix_.row(row).transpose();
+            scales_(row)     = force_.norm();
+        }
+    }
+
     if (equalitySet_.all()) {
         equality_hqp();
     } else {
@@ -28,66 +45,98 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::equality_hqp
 template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
 void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::inequality_hqp() {
     Eigen::Index idx;
-    int row;
+    int row = 0;
     double slack, dual, mValue;
-    bool isLowerBound;     // needed to distinguish between upper and lower bound in case they are both active
+    bool isLowerBound = false;     // needed to distinguish between upper and lower bound in case they are both active
+
+    // Hysteresis: a constraint must be clearly violated to enter and clearly wrong-signed to leave the active set
+    double activation   = activationMargin * tolerance;
+    double deactivation = deactivationMargin * tolerance;
 
     int maxChanges = 500;  // Maximum constraint activations + deactivations
     changes        = 0;
+    cycles         = 0;
 
-    // Lexicographic progress tracking
-    double cost, best_cost;
-    int stale, budget;
+    // Lexicographic progress tracking: a change is progress if it lowers the costs of the levels up to the current one
+    int stale, budget, kept;
+
+    // Most violated inactive bound of level k, if it beats the one found so far
+    auto find_violation = [&](int k) {
+        int dim = breaks_(k) - breaksAct_(k);
+        if (dim == 0) {
+            return;
+        }
+        vector_.segment(breaksAct_(k), dim).noalias() = matrix_.middleRows(breaksAct_(k), dim) * primal_;
+
+        mValue = (vector_.segment(breaksAct_(k), dim) -
+                  (!activeUpSet_.segment(breaksAct_(k), dim))
+                    .select(upper_.segment(breaksAct_(k), dim), std::numeric_limits<double>::infinity()))
+                   .maxCoeff(&idx);
+        if (mValue > activation && mValue > slack) {
+            slack        = mValue;
+            row          = breaksAct_(k) + idx;
+            isLowerBound = false;
+        }
+
+        mValue = ((!activeLowSet_.segment(breaksAct_(k), dim))
+                    .select(lower_.segment(breaksAct_(k), dim), -std::numeric_limits<double>::infinity()) -
+                  vector_.segment(breaksAct_(k), dim))
+                   .maxCoeff(&idx);
+        if (mValue > activation && mValue > slack) {
+            slack        = mValue;
+            row          = breaksAct_(k) + idx;
+            isLowerBound = true;
+        }
+    };
 
     equality_hqp();
     for (int h = 0; changes < maxChanges && h < lev_; ++h) {
+        // Levels from k_ on have no DOFs left: they can only improve by releasing free rows of the levels above
+        if (h >= k_ && breaksAct_.head(k_).sum() == breaksFix_.head(k_).sum()) {
+            break;
+        }
         slack = dual = 1;
 
-        best_cost = get_level_cost(h);
-        stale     = 0;
-        budget    = 2 * (breaks_(h) - (h == 0 ? 0 : breaks_(h - 1)));
+        update_costs(h + 1);
+        entryCosts_.head(h + 1) = bestCosts_.head(h + 1) = costs_.head(h + 1);
+        stale  = 0;
+        budget = 4 * (breaks_(h) - (h == 0 ? 0 : breaks_(h - 1)));
+        kept   = 0;
+        changeLog_.clear();
+        blocked_.head(breaks_(lev_ - 1)).setZero();
+
+        historySize_ = historyHead_ = 0;
+        is_cycling();
 
         while ((slack > 0 || dual > 0) && changes < maxChanges && stale < budget) {
             // Add tasks to the active set.
+            // Only the levels above k_ and the current one can move the primal or the duals of level h
             slack = -1;
-            for (int k = 0; k < lev_; ++k) {
-                int dim = breaks_(k) - breaksAct_(k);
-                if (dim > 0) {
-                    vector_.segment(breaksAct_(k), dim).noalias() = matrix_.middleRows(breaksAct_(k), dim) * primal_;
-
-                    mValue = (vector_.segment(breaksAct_(k), dim) -
-                              (!activeUpSet_.segment(breaksAct_(k), dim))
-                                .select(upper_.segment(breaksAct_(k), dim), std::numeric_limits<double>::infinity()))
-                               .maxCoeff(&idx);
-                    if (mValue > tolerance && mValue > slack) {
-                        slack        = mValue;
-                        row          = breaksAct_(k) + idx;
-                        isLowerBound = false;
-                    }
-
-                    mValue = ((!activeLowSet_.segment(breaksAct_(k), dim))
-                                .select(lower_.segment(breaksAct_(k), dim), -std::numeric_limits<double>::infinity()) -
-                              vector_.segment(breaksAct_(k), dim))
-                               .maxCoeff(&idx);
-                    if (mValue > tolerance && mValue > slack) {
-                        slack        = mValue;
-                        row          = breaksAct_(k) + idx;
-                        isLowerBound = true;
-                    }
-                }
+            for (int k = 0; k < std::min(k_, lev_); ++k) {
+                find_violation(k);
+            }
+            if (h >= k_) {
+                find_violation(h);
             }
-            if (slack > tolerance) {
+            if (slack > activation) {
+                changeLog_.push_back(4 * perm_(row) + 2 + isLowerBound);
                 decrement_from(level_(row));
                 activate_constraint(row, isLowerBound);
                 increment_from(level_(row));
                 ++changes;
-                cost = get_level_cost(h);
-                if (best_cost - cost > tolerance) {
-                    best_cost = cost;
-                    stale     = 0;
+                update_costs(h + 1);
+                if (compare_costs(h + 1, bestCosts_) < 0) {
+                    bestCosts_.head(h + 1) = costs_.head(h + 1);
+                    stale                  = 0;
                 } else {
                     ++stale;
                 }
+                kept = compare_costs(h, entryCosts_) <= 0 ? changeLog_.size() : kept;
+                if (is_cycling()) {
+                    // Back to an active set already visited at this level: keep the row that closed the cycle
+                    blocked_(breaksAct_(level_(row)) - 1) = true;
+                    ++cycles;
+                }
                 continue;
             }
 
@@ -97,32 +146,53 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::inequality_h
             dual = -1;
             for (auto k = 0; k <= h; ++k) {
                 int dim = breaksAct_(k) - breaksFix_(k);
-                if (dim > 0) {
+                if (dim > 0 && (k < k_ || k == h)) {
                     dual_.segment(breaksFix_(k), dim).noalias() =
                       activeUpSet_.segment(breaksFix_(k), dim)
                         .select(dual_.segment(breaksFix_(k), dim), -dual_.segment(breaksFix_(k), dim));
-                    mValue = dual_.segment(breaksFix_(k), dim).maxCoeff(&idx);
-                    if (mValue > tolerance && mValue > dual) {
+                    mValue = blocked_.segment(breaksFix_(k), dim)
+                               .select(-std::numeric_limits<double>::infinity(), dual_.segment(breaksFix_(k), dim))
+                               .maxCoeff(&idx);
+                    if (mValue > deactivation && mValue > dual) {
                         dual = mValue;
                         row  = breaksFix_(k) + idx;
                     }
                 }
             }
-            if (dual > tolerance) {
+            if (dual > deactivation) {
+                isLowerBound = activeLowSet_(row);
+                changeLog_.push_back(4 * perm_(row) + isLowerBound);
                 decrement_from(level_(row));
                 deactivate_constraint(row);
                 increment_from(level_(row));
                 ++changes;
-                cost = get_level_cost(h);
-                if (best_cost - cost > tolerance) {
-                    best_cost = cost;
-                    stale     = 0;
+                update_costs(h + 1);
+                if (compare_costs(h + 1, bestCosts_) < 0) {
+                    bestCosts_.head(h + 1) = costs_.head(h + 1);
+                    stale                  = 0;
                 } else {
                     ++stale;
                 }
+                kept = compare_costs(h, entryCosts_) <= 0 ? changeLog_.size() : kept;
+                if (is_cycling()) {
+                    // Releasing the row closes a cycle: restore it and keep it active for the rest of this level
+                    row = breaksAct_(level_(row));
+                    changeLog_.push_back(4 * perm_(row) + 2 + isLowerBound);
+                    decrement_from(level_(row));
+                    activate_constraint(row, isLowerBound);
+                    increment_from(level_(row));
+                    ++changes;
+                    blocked_(row) = true;
+                    ++cycles;
+                }
                 continue;
             }
 
+            // Converged, but locking would freeze a state worse for the levels above than the one found
+            update_costs(h);
+            if (compare_costs(h, entryCosts_) > 0) {
+                break;
+            }
             for (int k = 0; k <= h; ++k) {
                 for (int row = breaksFix_(k); row < breaksAct_(k); ++row) {
                     if (dual_(row) < -tolerance) {
@@ -131,6 +201,13 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::inequality_h
                 }
             }
         }
+
+        // A level must not leave the levels above worse than it found them: undo its changes past the last state that
+        // kept them, which is at worst the one it started from
+        update_costs(h);
+        if (compare_costs(h, entryCosts_) > 0) {
+            rollback(kept);
+        }
     }
 }
 
@@ -224,27 +301,37 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::increment_pr
       activeUpSet_.segment(start, n_rows).select(upper_.segment(start, n_rows), lower_.segment(start, n_rows)) -
       matrix_.middleRows(start, n_rows) * primal_;
 
-    // TODO: dynamically update tolerances to avoid tasks oscillations
+    // With a diagonal metric the nullspace basis of the first level only scales the columns
+    bool scaleOnly = parent < 0 && diagonalMetric_;
     if (parent < 0) {
-        nullSpace_.leftCols(dof).noalias() = cholMetric_.leftCols(dof);
+        if (!scaleOnly) {
+            nullSpace_.leftCols(dof).noalias() = cholMetric_.leftCols(dof);
+        }
     } else {
         nullSpace_.leftCols(dof).noalias() = codRights_[parent].middleCols(ranks_(parent), dof);
     }
-    cod_.setThreshold(tolerance);
-    cod_.compute(matrix_.middleRows(start, n_rows) * nullSpace_.leftCols(dof));
-    ranks_(k)   = cod_.rank();
-    int leftDof = dof - ranks_(k);
-
-    if (leftDof > 0) {
-        // In this case matrixZ() is not the identity, so Eigen computes it and is not garbage
-        codRights_[k].leftCols(dof).noalias() =
-          nullSpace_.leftCols(dof) * cod_.colsPermutation() * cod_.matrixZ().transpose();
-    } else {
-        codRights_[k].leftCols(dof).noalias() = nullSpace_.leftCols(dof) * cod_.colsPermutation();
+
+    double scale = n_rows > 0 ? scales_.segment(start, n_rows).maxCoeff() : 0.0;
+    Factorization method =
+      n_rows == 0 ? Factorization::COD
+                  : (k < static_cast<int>(factorizations_.size()) ? factorizations_[k] : defaultFactorization_);
+    switch (method) {
+        case Factorization::PivotedQR:
+            factorize_pivoted_qr(k, start, n_rows, dof, scaleOnly, scale);
+            break;
+        case Factorization::QR:
+            if (!factorize_qr(k, start, n_rows, dof, scaleOnly, scale)) {
+                factorize_cod(k, start, n_rows, dof, scaleOnly, scale);
+            }
+            break;
+        case Factorization::LDLT:
+            if (!factorize_ldlt(k, start, n_rows, dof, scaleOnly, scale)) {
+                factorize_cod(k, start, n_rows, dof, scaleOnly, scale);
+            }
+            break;
+        default:
+            factorize_cod(k, start, n_rows, dof, scaleOnly, scale);
     }
-    auto codLeft = codLefts_.block(start, 0, n_rows, n_rows);
-    codLeft.setIdentity();
-    cod_.householderQ().applyThisOnTheLeft(codLeft);
 
     inverse_.middleCols(col_ - dof, ranks_(k)).noalias() = codRights_[k].leftCols(ranks_(k));
     task_.segment(col_ - dof, ranks_(k)).noalias() =
@@ -252,13 +339,11 @@ void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::increment_pr
     dual_.segment(start, n_rows).noalias() =
       vector_.segment(start, n_rows) -
       codLefts_.block(start, 0, n_rows, ranks_(k)) * task_.segment(col_ - dof, ranks_(k));
-    cod_.matrixT()
+    codMids_[k]
       .topLeftCorner(ranks_(k), ranks_(k))
       .template triangularView<Eigen::Upper>()
       .template solveInPlace<Eigen::OnTheLeft>(task_.segment(col_ - dof, ranks_(k)));
     primal_.noalias() += inverse_.middleCols(col_ - dof, ranks_(k)) * task_.segment(col_ - dof, ranks_(k));
-
-    codMids_[k].topLeftCorner(ranks_(k), ranks_(k)).noalias() = cod_.matrixT().topLeftCorner(ranks_(k), ranks_(k));
 }
 
 }  // namespace hqp
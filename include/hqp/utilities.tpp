@@ -6,6 +6,15 @@ namespace hqp {
 // TODO: upgrade to a logger keeping track of the active set
 template<int MaxRows, int MaxCols, int MaxLevels, int ROWS, int COLS, int LEVS>
 void HierarchicalQP<MaxRows, MaxCols, MaxLevels, ROWS, COLS, LEVS>::print_active_set(std::ostream& os) {
+    if (blocks > 0) {
+        for (std::size_t b = 0; b < blocks_.size(); ++b) {
+            os << "Block " << b << " (variables";
+            for (int col : blockCols_[b]) os << " " << col;
+            os << "):\n";
+            blocks_[b].print_active_set(os);
+        }
+        return;
+    }
     os << "Active set:\n";
     for (int start = 0, k = 0; k < k_; ++k) {
         os << "\tLevel " << k << ":\n";
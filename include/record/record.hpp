@@ -0,0 +1,182 @@
+#ifndef HQP_RECORD_HPP
+#define HQP_RECORD_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+#include "../hqp/hqp.hpp"
+
+namespace hqp {
+
+/**
+ * Binary problem log.
+ *
+ * A log is a file header followed by one record per problem. Every field is stored in native byte order and every
+ * block starts on an 8-byte boundary, so a mapped log is read in place without copies:
+ *
+ *   LogFileHeader
+ *   repeat:
+ *     LogRecordHeader
+ *     matrix                 rows * cols doubles, column-major
+ *     lower, upper           rows doubles each
+ *     breaks                 levels int32, padded to 8 bytes
+ *     metric (optional)      cols doubles if kMetricDiagonal, cols * cols doubles if kMetricDense
+ *     warm start (optional)  cols doubles of guess, then rows + rows bytes of active lower/upper flags, padded
+ *
+ * Records taken from a solver also carry its tolerance and margins (kSettings).
+ * The metric is stored as the solver keeps it: the inverse of its upper Cholesky factor.
+ */
+struct LogFileHeader {
+    char magic[8]               = {'H', 'Q', 'P', 'L', 'O', 'G', '\0', '\0'};
+    std::uint32_t version       = 1;
+    std::uint32_t byteOrderMark = 0x01020304;
+    std::uint64_t reserved[2]   = {0, 0};
+};
+
+
+struct LogRecordHeader {
+    /** Record flags. */
+    enum : std::uint32_t { kMetricDiagonal = 1, kMetricDense = 2, kWarmStart = 4, kSettings = 8 };
+
+    std::uint32_t magic = 0x4B434954;  // "TICK"
+    std::uint32_t flags = 0;
+    /** Size of the whole record, header included. */
+    std::uint64_t bytes    = 0;
+    std::uint64_t sequence = 0;
+    /** Wall-clock time of the record, in nanoseconds since the epoch. */
+    std::int64_t timestamp = 0;
+    std::int32_t rows      = 0;
+    std::int32_t cols      = 0;
+    std::int32_t levels    = 0;
+    std::int32_t reserved  = 0;
+    double tolerance          = 0;
+    double activationMargin   = 0;
+    double deactivationMargin = 0;
+};
+
+
+/** One record of a log, viewed in place. */
+struct LogRecord {
+    const LogRecordHeader* header;
+    Eigen::Map<const Eigen::MatrixXd> matrix;
+    Eigen::Map<const Eigen::VectorXd> lower;
+    Eigen::Map<const Eigen::VectorXd> upper;
+    Eigen::Map<const Eigen::Matrix<std::int32_t, Eigen::Dynamic, 1>> breaks;
+    /** Inverse Cholesky factor (cols x cols), its diagonal (cols x 1), or empty. */
+    Eigen::Map<const Eigen::MatrixXd> metricFactor;
+    /** Warm start, empty if not recorded. */
+    Eigen::Map<const Eigen::VectorXd> guess;
+    Eigen::Map<const Eigen::Array<std::uint8_t, Eigen::Dynamic, 1>> activeLow;
+    Eigen::Map<const Eigen::Array<std::uint8_t, Eigen::Dynamic, 1>> activeUp;
+};
+
+
+/**
+ * @brief Appends problems to a binary log from a background thread.
+ *
+ * Recording serializes the problem into a pooled buffer and hands it to the writer thread, so the caller never
+ * waits on the file. Once the buffers have grown to the problem size, recording does not allocate. If the writer
+ * falls behind by more than `capacity` records, new records are dropped and counted instead of blocking the caller.
+ */
+class LogWriter : public ProblemRecorder {
+  private:
+    std::FILE* file_;
+    std::size_t capacity_;
+    std::uint64_t sequence_ = 0;
+    std::uint64_t dropped_  = 0;
+    bool stop_              = false;
+    bool writing_           = false;
+
+    std::deque<std::vector<char>> queue_;
+    std::vector<std::vector<char>> pool_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::thread thread_;
+
+    /** Takes a buffer from the pool; false if the writer is too far behind and the record must be dropped. */
+    bool acquire(std::vector<char>& buffer);
+    /** Serializes a record with the given flags and queues it. */
+    void append(const ProblemSnapshot& problem, std::uint32_t flags);
+    /** Queues a serialized record. */
+    void submit(std::vector<char>&& buffer);
+    /** Writer thread loop. */
+    void run();
+
+  public:
+    /**
+     * @brief Creates (or truncates) a log file and starts the writer thread.
+     * @param path     Log file path
+     * @param capacity Maximum number of records waiting to be written
+     */
+    explicit LogWriter(const std::string& path, std::size_t capacity = 256);
+    /** Writes the pending records and closes the file. */
+    ~LogWriter() override;
+
+    LogWriter(const LogWriter&)            = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    /** Records a problem with its solver state; called by HierarchicalQP::set_problem(). */
+    void record(const ProblemSnapshot& problem) override;
+
+    /**
+     * @brief Records the current problem of a stack of tasks, without metric nor warm start.
+     * @param stack Any stack providing get_stack(), e.g. StackOfTasks
+     */
+    template<typename StackType>
+    void record_stack(StackType& stack);
+
+    /** Blocks until every queued record is written and flushed to the file. */
+    void flush();
+
+    /** Number of records dropped because the writer fell behind. */
+    std::uint64_t dropped();
+};
+
+
+/**
+ * @brief Reads a binary log through a read-only memory mapping.
+ *
+ * The records are indexed on opening. A truncated last record, as left by a crashed process, is ignored.
+ */
+class LogReader {
+  private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::vector<char> buffer_;
+    std::vector<std::size_t> offsets_;
+
+  public:
+    /** Opens and indexes a log; throws std::runtime_error if it is not a valid log. */
+    explicit LogReader(const std::string& path);
+    ~LogReader();
+
+    LogReader(const LogReader&)            = delete;
+    LogReader& operator=(const LogReader&) = delete;
+
+    /** Number of records. */
+    std::size_t size() const;
+
+    /** Views the record at `index` in place. */
+    LogRecord operator[](std::size_t index) const;
+
+    /**
+     * @brief Restores a recorded problem on a solver: settings, metric, warm start, then set_problem().
+     * @param index  Record index
+     * @param solver Solver constructed with the rows and columns of the record
+     */
+    template<typename Solver>
+    void restore(std::size_t index, Solver& solver) const;
+};
+
+}  // namespace hqp
+
+#include "record.tpp"
+
+#endif  // HQP_RECORD_HPP
@@ -0,0 +1,359 @@
+#ifndef HQP_RECORD_TPP
+#define HQP_RECORD_TPP
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HQP_RECORD_MMAP 1
+#endif
+
+namespace hqp {
+
+/** Rounds a block size up to the 8-byte alignment of the log. */
+inline std::size_t log_padded(std::size_t bytes) {
+    return (bytes + 7) & ~std::size_t{7};
+}
+
+
+/** Size of a record with the dimensions and flags of its header, 0 if they cannot describe one. */
+inline std::size_t log_record_bytes(const LogRecordHeader& header) {
+    // Negative or absurd dimensions would wrap the size computation around
+    if (header.rows < 0 || header.cols < 0 || header.levels < 0 ||
+        (double(header.rows) + header.cols) * header.cols > 1e15) {
+        return 0;
+    }
+    std::size_t rows = header.rows, cols = header.cols;
+    std::size_t metric = (header.flags & LogRecordHeader::kMetricDense)      ? cols * cols
+                         : (header.flags & LogRecordHeader::kMetricDiagonal) ? cols
+                                                                             : 0;
+    std::size_t bytes  = sizeof(header) + sizeof(double) * (rows * cols + 2 * rows + metric) +
+                         log_padded(sizeof(std::int32_t) * header.levels);
+    if (header.flags & LogRecordHeader::kWarmStart) {
+        bytes += sizeof(double) * cols + log_padded(2 * rows);
+    }
+    return bytes;
+}
+
+
+inline LogWriter::LogWriter(const std::string& path, std::size_t capacity)
+  : file_(std::fopen(path.c_str(), "wb"))
+  , capacity_(capacity) {
+    if (!file_) {
+        throw std::runtime_error("Cannot open log file " + path);
+    }
+    LogFileHeader header;
+    std::fwrite(&header, sizeof(header), 1, file_);
+    thread_ = std::thread(&LogWriter::run, this);
+}
+
+
+inline LogWriter::~LogWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    std::fclose(file_);
+}
+
+
+inline void LogWriter::record(const ProblemSnapshot& problem) {
+    append(problem,
+           (problem.diagonalMetric ? LogRecordHeader::kMetricDiagonal : LogRecordHeader::kMetricDense) |
+             LogRecordHeader::kWarmStart | LogRecordHeader::kSettings);
+}
+
+
+template<typename StackType>
+void LogWriter::record_stack(StackType& stack) {
+    auto [matrix, lower, upper, breaks] = stack.get_stack();
+    append({matrix,
+            lower,
+            upper,
+            breaks,
+            Eigen::MatrixXd(0, 0),
+            false,
+            Eigen::VectorXd(0),
+            Eigen::Array<bool, Eigen::Dynamic, 1>(0),
+            Eigen::Array<bool, Eigen::Dynamic, 1>(0),
+            0.0,
+            0.0,
+            0.0},
+           0);
+}
+
+
+inline void LogWriter::append(const ProblemSnapshot& problem, std::uint32_t flags) {
+    std::vector<char> buffer;
+    if (!acquire(buffer)) {
+        return;
+    }
+
+    LogRecordHeader header;
+    header.flags              = flags;
+    header.rows               = problem.matrix.rows();
+    header.cols               = problem.matrix.cols();
+    header.levels             = problem.breaks.size();
+    header.tolerance          = problem.tolerance;
+    header.activationMargin   = problem.activationMargin;
+    header.deactivationMargin = problem.deactivationMargin;
+    header.timestamp          = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+
+    std::size_t rows = header.rows, cols = header.cols;
+    std::size_t metric = (flags & LogRecordHeader::kMetricDense)      ? cols * cols
+                         : (flags & LogRecordHeader::kMetricDiagonal) ? cols
+                                                                      : 0;
+    header.bytes = log_record_bytes(header);
+    buffer.assign(header.bytes, 0);
+
+    char* out = buffer.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    Eigen::Map<Eigen::MatrixXd>(reinterpret_cast<double*>(out), rows, cols) = problem.matrix;
+    out += sizeof(double) * rows * cols;
+    Eigen::Map<Eigen::VectorXd>(reinterpret_cast<double*>(out), rows) = problem.lower;
+    out += sizeof(double) * rows;
+    Eigen::Map<Eigen::VectorXd>(reinterpret_cast<double*>(out), rows) = problem.upper;
+    out += sizeof(double) * rows;
+    Eigen::Map<Eigen::Matrix<std::int32_t, Eigen::Dynamic, 1>>(reinterpret_cast<std::int32_t*>(out), header.levels) =
+      problem.breaks.cast<std::int32_t>();
+    out += log_padded(sizeof(std::int32_t) * header.levels);
+    if (flags & LogRecordHeader::kMetricDense) {
+        Eigen::Map<Eigen::MatrixXd>(reinterpret_cast<double*>(out), cols, cols) = problem.metricFactor;
+    } else if (flags & LogRecordHeader::kMetricDiagonal) {
+        Eigen::Map<Eigen::VectorXd>(reinterpret_cast<double*>(out), cols) = problem.metricFactor.diagonal();
+    }
+    out += sizeof(double) * metric;
+    if (flags & LogRecordHeader::kWarmStart) {
+        Eigen::Map<Eigen::VectorXd>(reinterpret_cast<double*>(out), cols) = problem.guess;
+        out += sizeof(double) * cols;
+        Eigen::Map<Eigen::Array<std::uint8_t, Eigen::Dynamic, 1>>(reinterpret_cast<std::uint8_t*>(out), rows) =
+          problem.activeLow.cast<std::uint8_t>();
+        out += rows;
+        Eigen::Map<Eigen::Array<std::uint8_t, Eigen::Dynamic, 1>>(reinterpret_cast<std::uint8_t*>(out), rows) =
+          problem.activeUp.cast<std::uint8_t>();
+    }
+
+    submit(std::move(buffer));
+}
+
+
+inline bool LogWriter::acquire(std::vector<char>& buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.size() >= capacity_) {
+        ++dropped_;
+        return false;
+    }
+    if (!pool_.empty()) {
+        buffer = std::move(pool_.back());
+        pool_.pop_back();
+    }
+    return true;
+}
+
+
+inline void LogWriter::submit(std::vector<char>&& buffer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reinterpret_cast<LogRecordHeader*>(buffer.data())->sequence = sequence_++;
+        queue_.push_back(std::move(buffer));
+    }
+    wake_.notify_one();
+}
+
+
+inline void LogWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            break;
+        }
+        std::vector<char> buffer = std::move(queue_.front());
+        queue_.pop_front();
+        writing_ = true;
+
+        lock.unlock();
+        std::fwrite(buffer.data(), 1, buffer.size(), file_);
+        lock.lock();
+
+        writing_ = false;
+        pool_.push_back(std::move(buffer));
+        if (queue_.empty()) {
+            idle_.notify_all();
+        }
+    }
+}
+
+
+inline void LogWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return queue_.empty() && !writing_; });
+    std::fflush(file_);
+}
+
+
+inline std::uint64_t LogWriter::dropped() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
+
+
+inline LogReader::LogReader(const std::string& path) {
+#ifdef HQP_RECORD_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open log file " + path);
+    }
+    struct stat status;
+    if (::fstat(fd, &status) == 0 && status.st_size > 0) {
+        size_      = status.st_size;
+        void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        data_      = data == MAP_FAILED ? nullptr : static_cast<const char*>(data);
+    }
+    ::close(fd);
+    if (!data_) {
+        size_ = 0;
+    }
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open log file " + path);
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+
+    LogFileHeader expected, header;
+    if (size_ < sizeof(header)) {
+        throw std::runtime_error("Not an HQP log: " + path);
+    }
+    std::memcpy(&header, data_, sizeof(header));
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not an HQP log: " + path);
+    }
+    if (header.version != expected.version) {
+        throw std::runtime_error("Unsupported HQP log version " + std::to_string(header.version));
+    }
+    if (header.byteOrderMark != expected.byteOrderMark) {
+        throw std::runtime_error("HQP log written with a different byte order");
+    }
+
+    // A record cut short by a crash ends the log
+    LogRecordHeader record;
+    for (std::size_t offset = sizeof(header); offset + sizeof(record) <= size_; offset += record.bytes) {
+        std::memcpy(&record, data_ + offset, sizeof(record));
+        if (record.magic != LogRecordHeader().magic) {
+            throw std::runtime_error("Corrupt HQP log record at offset " + std::to_string(offset));
+        }
+        if (record.bytes < sizeof(record) || record.bytes > size_ - offset) {
+            break;
+        }
+        if (record.bytes != log_record_bytes(record)) {
+            throw std::runtime_error("Corrupt HQP log record at offset " + std::to_string(offset));
+        }
+        offsets_.push_back(offset);
+    }
+}
+
+
+inline LogReader::~LogReader() {
+#ifdef HQP_RECORD_MMAP
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+
+inline std::size_t LogReader::size() const {
+    return offsets_.size();
+}
+
+
+inline LogRecord LogReader::operator[](std::size_t index) const {
+    const char* in      = data_ + offsets_.at(index);
+    auto header         = reinterpret_cast<const LogRecordHeader*>(in);
+    if (header->bytes != log_record_bytes(*header)) {
+        throw std::runtime_error("Corrupt HQP log record " + std::to_string(index));
+    }
+    std::size_t rows    = header->rows;
+    std::size_t cols    = header->cols;
+    std::size_t metric  = (header->flags & LogRecordHeader::kMetricDense)      ? cols
+                          : (header->flags & LogRecordHeader::kMetricDiagonal) ? 1
+                                                                               : 0;
+    std::size_t warm    = (header->flags & LogRecordHeader::kWarmStart) ? 1 : 0;
+    auto doubles        = [&in](std::size_t count) {
+        auto data  = reinterpret_cast<const double*>(in);
+        in        += sizeof(double) * count;
+        return data;
+    };
+
+    in += sizeof(LogRecordHeader);
+    auto matrix = doubles(rows * cols);
+    auto lower  = doubles(rows);
+    auto upper  = doubles(rows);
+    auto breaks = reinterpret_cast<const std::int32_t*>(in);
+    in += log_padded(sizeof(std::int32_t) * header->levels);
+    auto factor = doubles(cols * metric);
+    auto guess  = doubles(cols * warm);
+    auto flags  = reinterpret_cast<const std::uint8_t*>(in);
+
+    return {header,
+            {matrix, Eigen::Index(rows), Eigen::Index(cols)},
+            {lower, Eigen::Index(rows)},
+            {upper, Eigen::Index(rows)},
+            {breaks, header->levels},
+            {factor, Eigen::Index(cols * (metric > 0)), Eigen::Index(metric)},
+            {guess, Eigen::Index(cols * warm)},
+            {flags, Eigen::Index(rows * warm)},
+            {flags + rows, Eigen::Index(rows * warm)}};
+}
+
+
+template<typename Solver>
+void LogReader::restore(std::size_t index, Solver& solver) const {
+    LogRecord record = (*this)[index];
+    int rows         = record.header->rows;
+    if (rows != solver.activeLowSet_.size() || record.header->cols != solver.col_) {
+        throw std::invalid_argument("Solver size does not match the recorded problem");
+    }
+
+    if (record.header->flags & LogRecordHeader::kSettings) {
+        solver.tolerance          = record.header->tolerance;
+        solver.activationMargin   = record.header->activationMargin;
+        solver.deactivationMargin = record.header->deactivationMargin;
+    }
+    if (record.header->flags & LogRecordHeader::kMetricDense) {
+        solver.cholMetric_     = record.metricFactor;
+        solver.diagonalMetric_ = false;
+    } else if (record.header->flags & LogRecordHeader::kMetricDiagonal) {
+        solver.cholMetric_.setZero();
+        solver.cholMetric_.diagonal() = record.metricFactor;
+        solver.diagonalMetric_        = true;
+    }
+    if (record.header->flags & LogRecordHeader::kWarmStart) {
+        // Flags are stored in the row order of the problem, which set_problem() reads through perm_
+        solver.guess_ = record.guess;
+        for (int i = 0; i < rows; ++i) solver.perm_(i) = i;
+        solver.activeLowSet_.head(rows) = record.activeLow != 0;
+        solver.activeUpSet_.head(rows)  = record.activeUp != 0;
+    }
+    solver.set_problem(record.matrix, record.lower, record.upper, record.breaks.template cast<int>());
+}
+
+}  // namespace hqp
+
+#endif  // HQP_RECORD_TPP
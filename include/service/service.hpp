@@ -0,0 +1,218 @@
+#ifndef HQP_SERVICE_HPP
+#define HQP_SERVICE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+#include "../hqp/hqp.hpp"
+
+namespace hqp {
+
+/**
+ * Local solver service over POSIX shared memory.
+ *
+ * A SolverService owns one shared-memory segment split into channels. A ServiceClient, in any process of the same
+ * machine, claims a free channel and talks to the service through two single-producer/single-consumer rings: the
+ * client produces requests and consumes responses, the worker thread serving the channel does the opposite. Neither
+ * side takes a lock or makes a system call on the fast path; an idle side spins, then yields, then sleeps.
+ *
+ * Every block starts on a cache line, and a request slot holds the arguments of set_problem() in place:
+ *
+ *   ServiceHeader
+ *   repeat for each channel:
+ *     ChannelHeader
+ *     depth request slots:   ServiceSlotHeader, matrix (rows * cols doubles, column-major), lower, upper (rows
+ *                            doubles each), breaks (levels int32)
+ *     depth response slots:  ServiceSlotHeader, primal (cols doubles)
+ *
+ * The service keeps one solver per channel, so every client is warm-started from its own previous solve.
+ */
+struct ServiceHeader {
+    char magic[8]              = {'H', 'Q', 'P', 'S', 'H', 'M', '\0', '\0'};
+    std::uint32_t version      = 1;
+    std::uint32_t channels     = 0;
+    std::uint32_t depth        = 0;
+    std::int32_t maxRows       = 0;
+    std::int32_t maxCols       = 0;
+    std::int32_t maxLevels     = 0;
+    std::uint64_t requestSize  = 0;
+    std::uint64_t responseSize = 0;
+    std::uint64_t channelSize  = 0;
+    /** Set by the service once every channel is initialized. */
+    std::atomic<std::uint32_t> ready{0};
+    /** Set by the service when it stops; pending and later requests fail. */
+    std::atomic<std::uint32_t> stopped{0};
+};
+
+
+/** Ring indices of a channel, each on its own cache line to keep producer and consumer from sharing one. */
+struct ChannelHeader {
+    /** Process id of the client owning the channel, 0 if free. */
+    alignas(64) std::atomic<std::int64_t> owner{0};
+    /** Incremented on every claim, so the service drops the warm start of the previous client. */
+    std::atomic<std::uint64_t> generation{0};
+    alignas(64) std::atomic<std::uint64_t> requestHead{0};
+    alignas(64) std::atomic<std::uint64_t> requestTail{0};
+    alignas(64) std::atomic<std::uint64_t> responseHead{0};
+    alignas(64) std::atomic<std::uint64_t> responseTail{0};
+};
+
+
+struct ServiceSlotHeader {
+    /** Request flags. */
+    enum : std::uint32_t { kColdStart = 1 };
+    /** Response status. */
+    enum : std::int32_t { kSolved = 0, kFailed = 1 };
+
+    std::int32_t rows   = 0;
+    std::int32_t cols   = 0;
+    std::int32_t levels = 0;
+    /** Request flags, or response status. */
+    std::int32_t flags    = 0;
+    std::uint64_t sequence = 0;
+    /** Active-set changes of the solve. */
+    std::int32_t changes  = 0;
+    std::int32_t reserved = 0;
+    /** Error message of a failed solve. */
+    char message[96] = {};
+};
+
+
+/** Arguments of set_problem() inside a request slot, filled in place by the client. */
+struct ServiceProblem {
+    Eigen::Map<Eigen::MatrixXd> matrix;
+    Eigen::Map<Eigen::VectorXd> lower;
+    Eigen::Map<Eigen::VectorXd> upper;
+    Eigen::Map<Eigen::Matrix<std::int32_t, Eigen::Dynamic, 1>> breaks;
+};
+
+
+/** Size and threading of a SolverService. */
+struct ServiceOptions {
+    /** Number of clients served at once. */
+    int channels = 8;
+    /** Requests (and responses) in flight per channel. */
+    int depth = 2;
+    /** Largest problem a request can carry. */
+    int maxRows   = 256;
+    int maxCols   = 64;
+    int maxLevels = 16;
+    /** Worker threads; channel c is served by worker c % threads. */
+    int threads = 1;
+    /** Cores the workers are pinned to, worker w on cores[w % size]; empty to leave them unpinned. */
+    std::vector<int> cores;
+};
+
+
+/**
+ * @brief Serves solve requests from other processes through a shared-memory segment.
+ *
+ * The constructor creates the segment `name` (a POSIX shared-memory name such as "/hqp") and starts the workers;
+ * the destructor stops them and removes the segment. Each worker owns the channels it serves and their solvers, so
+ * requests of different clients never wait on each other unless they share a worker.
+ */
+class SolverService {
+  private:
+    struct Channel {
+        std::unique_ptr<HierarchicalQP<>> solver;
+        std::uint64_t generation = 0;
+        int rows                 = 0;
+        int cols                 = 0;
+    };
+
+    std::string name_;
+    ServiceOptions options_;
+    char* data_       = nullptr;
+    std::size_t size_ = 0;
+    std::atomic<bool> stop_{false};
+    std::vector<Channel> channels_;
+    std::vector<std::thread> workers_;
+
+    /** Worker loop serving the channels c with c % threads == worker. */
+    void run(int worker);
+    /** Solves the request at the tail of a channel and publishes the response. */
+    void serve(int channel);
+
+  public:
+    /** Creates the segment and starts the workers; throws std::runtime_error if the segment cannot be created. */
+    SolverService(const std::string& name, const ServiceOptions& options = {});
+    /** Stops the workers and removes the segment. */
+    ~SolverService();
+
+    SolverService(const SolverService&)            = delete;
+    SolverService& operator=(const SolverService&) = delete;
+
+    /** Shared-memory name of the service. */
+    const std::string& name() const;
+};
+
+
+/**
+ * @brief Client of a SolverService running in this or another process.
+ *
+ * A client fills a request slot in place through request(), hands it over with submit() and reads the solution with
+ * receive(). Up to the depth of the service can be in flight. A client is used from one thread at a time.
+ */
+class ServiceClient {
+  private:
+    char* data_       = nullptr;
+    std::size_t size_ = 0;
+    int channel_      = -1;
+    int changes_      = 0;
+    /** Whether the client still reads the response at the tail of the ring. */
+    bool holding_ = false;
+
+    const ServiceHeader& header() const;
+    ChannelHeader& channel() const;
+    char* request_slot(std::uint64_t index) const;
+    char* response_slot(std::uint64_t index) const;
+
+  public:
+    /**
+     * @brief Attaches to a running service and claims a free channel.
+     * @param name    Shared-memory name of the service
+     * @param timeout Seconds to wait for the service to come up
+     */
+    explicit ServiceClient(const std::string& name, double timeout = 1.0);
+    /** Releases the channel; the service drops its warm start. */
+    ~ServiceClient();
+
+    ServiceClient(const ServiceClient&)            = delete;
+    ServiceClient& operator=(const ServiceClient&) = delete;
+
+    /** Channel claimed by this client. */
+    int channel_index() const;
+
+    /**
+     * @brief Waits for a free request slot and views it as a problem of the given size, to be filled in place.
+     * @param coldStart Solve without the warm start of the previous request
+     */
+    ServiceProblem request(int rows, int cols, int levels, bool coldStart = false);
+    /** Hands the slot returned by the last request() to the service. */
+    void submit();
+    /**
+     * @brief Waits for the oldest submitted request and returns its primal, valid until the next receive().
+     *
+     * Throws std::runtime_error if the service failed to solve it or stopped.
+     */
+    Eigen::Map<const Eigen::VectorXd> receive();
+    /** Active-set changes of the last received solve. */
+    int changes() const;
+
+    /** Copies a problem into a request, submits it and waits for its solution; no other request may be in flight. */
+    template<typename MatrixType, typename LowerType, typename UpperType, typename BreaksType>
+    Eigen::VectorXd solve(const MatrixType& matrix,
+                          const LowerType& lower,
+                          const UpperType& upper,
+                          const BreaksType& breaks);
+};
+
+}  // namespace hqp
+
+#include "service.tpp"
+
+#endif  // HQP_SERVICE_HPP
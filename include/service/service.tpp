@@ -0,0 +1,394 @@
+#ifndef HQP_SERVICE_TPP
+#define HQP_SERVICE_TPP
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hqp {
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::int64_t>::is_always_lock_free,
+              "The service rings need lock-free 64-bit atomics to be shared between processes");
+
+/** Rounds a block size up to a cache line. */
+inline std::size_t service_padded(std::size_t bytes) {
+    return (bytes + 63) & ~std::size_t{63};
+}
+
+
+/** Offsets of the blocks of a request slot. */
+struct ServiceRequestLayout {
+    std::size_t matrix, lower, upper, breaks, size;
+
+    ServiceRequestLayout(int maxRows, int maxCols, int maxLevels) {
+        matrix = service_padded(sizeof(ServiceSlotHeader));
+        lower  = matrix + service_padded(sizeof(double) * maxRows * maxCols);
+        upper  = lower + service_padded(sizeof(double) * maxRows);
+        breaks = upper + service_padded(sizeof(double) * maxRows);
+        size   = breaks + service_padded(sizeof(std::int32_t) * maxLevels);
+    }
+};
+
+
+/** Waits with a spin, then yield, then sleep backoff until `ready()` holds; false if `abort()` holds first. */
+template<typename Ready, typename Abort>
+bool service_wait(Ready ready, Abort abort) {
+    for (int idle = 0; !ready(); ++idle) {
+        if (abort()) {
+            return false;
+        }
+        if (idle < 64) {
+            continue;
+        } else if (idle < 1024) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    return true;
+}
+
+
+inline SolverService::SolverService(const std::string& name, const ServiceOptions& options)
+  : name_(name)
+  , options_(options)
+  , channels_(options.channels) {
+    if (options.channels < 1 || options.depth < 1 || options.threads < 1 || options.maxRows < 1 ||
+        options.maxCols < 1 || options.maxLevels < 1) {
+        throw std::invalid_argument("Service options must all be positive");
+    }
+
+    ServiceRequestLayout request(options.maxRows, options.maxCols, options.maxLevels);
+    std::size_t response = service_padded(sizeof(ServiceSlotHeader)) + service_padded(sizeof(double) * options.maxCols);
+    std::size_t channel  = service_padded(sizeof(ChannelHeader)) + options.depth * (request.size + response);
+    size_                = service_padded(sizeof(ServiceHeader)) + options.channels * channel;
+
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create shared memory " + name + ": " + std::strerror(errno));
+    }
+    void* data = MAP_FAILED;
+    if (::ftruncate(fd, size_) == 0) {
+        data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        ::shm_unlink(name.c_str());
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+    data_ = static_cast<char*>(data);
+
+    auto header          = new (data_) ServiceHeader;
+    header->channels     = options.channels;
+    header->depth        = options.depth;
+    header->maxRows      = options.maxRows;
+    header->maxCols      = options.maxCols;
+    header->maxLevels    = options.maxLevels;
+    header->requestSize  = request.size;
+    header->responseSize = response;
+    header->channelSize  = channel;
+    for (int c = 0; c < options.channels; ++c) {
+        new (data_ + service_padded(sizeof(ServiceHeader)) + c * channel) ChannelHeader;
+    }
+    header->ready.store(1, std::memory_order_release);
+
+    for (int worker = 0; worker < options.threads; ++worker) {
+        workers_.emplace_back(&SolverService::run, this, worker);
+#ifdef __linux__
+        if (!options.cores.empty()) {
+            cpu_set_t cores;
+            CPU_ZERO(&cores);
+            CPU_SET(options.cores[worker % options.cores.size()], &cores);
+            pthread_setaffinity_np(workers_.back().native_handle(), sizeof(cores), &cores);
+        }
+#endif
+    }
+}
+
+
+inline SolverService::~SolverService() {
+    reinterpret_cast<ServiceHeader*>(data_)->stopped.store(1, std::memory_order_release);
+    stop_ = true;
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    ::munmap(data_, size_);
+    ::shm_unlink(name_.c_str());
+}
+
+
+inline const std::string& SolverService::name() const {
+    return name_;
+}
+
+
+inline void SolverService::run(int worker) {
+    auto header = reinterpret_cast<const ServiceHeader*>(data_);
+    auto ring   = [&](int c) -> ChannelHeader& {
+        return *reinterpret_cast<ChannelHeader*>(data_ + service_padded(sizeof(ServiceHeader)) + c * header->channelSize);
+    };
+
+    // A request is served once there is room for its response
+    auto pending = [&](int c) {
+        auto& channel = ring(c);
+        return channel.requestHead.load(std::memory_order_acquire) !=
+                 channel.requestTail.load(std::memory_order_relaxed) &&
+               channel.responseHead.load(std::memory_order_relaxed) -
+                   channel.responseTail.load(std::memory_order_acquire) <
+                 header->depth;
+    };
+    while (true) {
+        bool served = false;
+        auto ready  = [&]() {
+            for (int c = worker; c < options_.channels; c += options_.threads) {
+                if (pending(c)) {
+                    serve(c);
+                    served = true;
+                }
+            }
+            return served;
+        };
+        if (!service_wait(ready, [this]() { return stop_.load(); })) {
+            return;
+        }
+    }
+}
+
+
+inline void SolverService::serve(int c) {
+    auto header   = reinterpret_cast<const ServiceHeader*>(data_);
+    char* base    = data_ + service_padded(sizeof(ServiceHeader)) + c * header->channelSize;
+    auto& channel = *reinterpret_cast<ChannelHeader*>(base);
+    std::uint64_t tail = channel.requestTail.load(std::memory_order_relaxed);
+    std::uint64_t head = channel.responseHead.load(std::memory_order_relaxed);
+
+    ServiceRequestLayout layout(header->maxRows, header->maxCols, header->maxLevels);
+    char* in     = base + service_padded(sizeof(ChannelHeader)) + (tail % header->depth) * header->requestSize;
+    char* out    = base + service_padded(sizeof(ChannelHeader)) + header->depth * header->requestSize +
+                (head % header->depth) * header->responseSize;
+    auto request  = reinterpret_cast<const ServiceSlotHeader*>(in);
+    auto response = new (out) ServiceSlotHeader;
+    response->sequence = request->sequence;
+    response->rows     = request->rows;
+    response->cols     = request->cols;
+
+    try {
+        int rows = request->rows, cols = request->cols, levels = request->levels;
+        if (rows < 1 || rows > header->maxRows || cols < 1 || cols > header->maxCols || levels < 1 ||
+            levels > header->maxLevels) {
+            throw std::invalid_argument("Request larger than the service slots");
+        }
+
+        // Every client is warm-started from its own previous solve, unless it changed or asked for a cold start
+        auto& state              = channels_[c];
+        std::uint64_t generation = channel.generation.load(std::memory_order_acquire);
+        if (!state.solver || state.generation != generation || (request->flags & ServiceSlotHeader::kColdStart) ||
+            state.rows != rows || state.cols != cols) {
+            state.solver     = std::make_unique<HierarchicalQP<>>(rows, cols);
+            state.generation = generation;
+            state.rows       = rows;
+            state.cols       = cols;
+        }
+
+        state.solver->set_problem(
+          Eigen::Map<const Eigen::MatrixXd>(reinterpret_cast<const double*>(in + layout.matrix), rows, cols),
+          Eigen::Map<const Eigen::VectorXd>(reinterpret_cast<const double*>(in + layout.lower), rows),
+          Eigen::Map<const Eigen::VectorXd>(reinterpret_cast<const double*>(in + layout.upper), rows),
+          Eigen::Map<const Eigen::Matrix<std::int32_t, Eigen::Dynamic, 1>>(
+            reinterpret_cast<const std::int32_t*>(in + layout.breaks), levels));
+        Eigen::Map<Eigen::VectorXd>(reinterpret_cast<double*>(out + service_padded(sizeof(ServiceSlotHeader))), cols) =
+          state.solver->get_primal();
+        response->flags   = ServiceSlotHeader::kSolved;
+        response->changes = state.solver->changes;
+    } catch (const std::exception& error) {
+        response->flags = ServiceSlotHeader::kFailed;
+        std::snprintf(response->message, sizeof(response->message), "%s", error.what());
+        channels_[c].solver.reset();
+    }
+
+    channel.responseHead.store(head + 1, std::memory_order_release);
+    channel.requestTail.store(tail + 1, std::memory_order_release);
+}
+
+
+inline ServiceClient::ServiceClient(const std::string& name, double timeout) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+    auto expired  = [&deadline]() { return std::chrono::steady_clock::now() > deadline; };
+
+    int fd = -1;
+    service_wait([&]() { return (fd = ::shm_open(name.c_str(), O_RDWR, 0)) >= 0; }, expired);
+    if (fd < 0) {
+        throw std::runtime_error("No solver service at " + name);
+    }
+    struct stat status;
+    void* data = MAP_FAILED;
+    if (::fstat(fd, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(ServiceHeader))) {
+        size_ = status.st_size;
+        data  = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map solver service " + name);
+    }
+    data_ = static_cast<char*>(data);
+
+    ServiceHeader expected;
+    if (std::memcmp(header().magic, expected.magic, sizeof(expected.magic)) != 0 ||
+        header().version != expected.version ||
+        !service_wait([this]() { return header().ready.load(std::memory_order_acquire) != 0; }, expired) ||
+        size_ < service_padded(sizeof(ServiceHeader)) + header().channels * header().channelSize) {
+        ::munmap(data_, size_);
+        throw std::runtime_error("Not a solver service: " + name);
+    }
+
+    // Claim a free channel, or one left by a process that died
+    std::int64_t pid = ::getpid();
+    for (int c = 0; c < static_cast<int>(header().channels) && channel_ < 0; ++c) {
+        channel_           = c;
+        std::int64_t owner = channel().owner.load();
+        bool dead          = owner != 0 && owner != pid && ::kill(owner, 0) != 0 && errno == ESRCH;
+        if (!((owner == 0 || dead) && channel().owner.compare_exchange_strong(owner, pid))) {
+            channel_ = -1;
+        }
+    }
+    if (channel_ < 0) {
+        ::munmap(data_, size_);
+        throw std::runtime_error("No free channel on solver service " + name);
+    }
+
+    // Requests left by a previous owner are still served: drop their responses, which also makes room for them
+    channel().generation.fetch_add(1, std::memory_order_acq_rel);
+    std::uint64_t head = channel().requestHead.load(std::memory_order_relaxed);
+    auto drained       = [&]() {
+        channel().responseTail.store(channel().responseHead.load(std::memory_order_acquire), std::memory_order_release);
+        return channel().requestTail.load(std::memory_order_acquire) == head;
+    };
+    service_wait(drained, [this]() { return header().stopped.load(std::memory_order_acquire) != 0; });
+    drained();
+}
+
+
+inline ServiceClient::~ServiceClient() {
+    channel().owner.store(0, std::memory_order_release);
+    ::munmap(data_, size_);
+}
+
+
+inline const ServiceHeader& ServiceClient::header() const {
+    return *reinterpret_cast<const ServiceHeader*>(data_);
+}
+
+
+inline ChannelHeader& ServiceClient::channel() const {
+    return *reinterpret_cast<ChannelHeader*>(data_ + service_padded(sizeof(ServiceHeader)) +
+                                             channel_ * header().channelSize);
+}
+
+
+inline char* ServiceClient::request_slot(std::uint64_t index) const {
+    return reinterpret_cast<char*>(&channel()) + service_padded(sizeof(ChannelHeader)) +
+           (index % header().depth) * header().requestSize;
+}
+
+
+inline char* ServiceClient::response_slot(std::uint64_t index) const {
+    return reinterpret_cast<char*>(&channel()) + service_padded(sizeof(ChannelHeader)) +
+           header().depth * header().requestSize + (index % header().depth) * header().responseSize;
+}
+
+
+inline int ServiceClient::channel_index() const {
+    return channel_;
+}
+
+
+inline ServiceProblem ServiceClient::request(int rows, int cols, int levels, bool coldStart) {
+    if (rows < 1 || rows > header().maxRows || cols < 1 || cols > header().maxCols || levels < 1 ||
+        levels > header().maxLevels) {
+        throw std::invalid_argument("Problem larger than the service slots");
+    }
+    std::uint64_t head = channel().requestHead.load(std::memory_order_relaxed);
+    if (!service_wait(
+          [&]() { return head - channel().requestTail.load(std::memory_order_acquire) < header().depth; },
+          [this]() { return header().stopped.load(std::memory_order_acquire) != 0; })) {
+        throw std::runtime_error("Solver service stopped");
+    }
+
+    char* slot       = request_slot(head);
+    auto slotHeader  = new (slot) ServiceSlotHeader;
+    slotHeader->rows     = rows;
+    slotHeader->cols     = cols;
+    slotHeader->levels   = levels;
+    slotHeader->flags    = coldStart ? ServiceSlotHeader::kColdStart : 0;
+    slotHeader->sequence = head;
+
+    ServiceRequestLayout layout(header().maxRows, header().maxCols, header().maxLevels);
+    return {{reinterpret_cast<double*>(slot + layout.matrix), rows, cols},
+            {reinterpret_cast<double*>(slot + layout.lower), rows},
+            {reinterpret_cast<double*>(slot + layout.upper), rows},
+            {reinterpret_cast<std::int32_t*>(slot + layout.breaks), levels}};
+}
+
+
+inline void ServiceClient::submit() {
+    channel().requestHead.fetch_add(1, std::memory_order_release);
+}
+
+
+inline Eigen::Map<const Eigen::VectorXd> ServiceClient::receive() {
+    // The slot returned by the previous receive() is released only now, so its primal stays valid until here
+    std::uint64_t tail = channel().responseTail.load(std::memory_order_relaxed);
+    if (holding_) {
+        channel().responseTail.store(++tail, std::memory_order_release);
+        holding_ = false;
+    }
+    if (!service_wait([&]() { return channel().responseHead.load(std::memory_order_acquire) != tail; },
+                      [this]() { return header().stopped.load(std::memory_order_acquire) != 0; })) {
+        throw std::runtime_error("Solver service stopped");
+    }
+
+    char* slot    = response_slot(tail);
+    auto response = reinterpret_cast<const ServiceSlotHeader*>(slot);
+    if (response->flags != ServiceSlotHeader::kSolved) {
+        std::string message = response->message;
+        channel().responseTail.store(tail + 1, std::memory_order_release);
+        throw std::runtime_error("Solver service failed: " + message);
+    }
+    holding_ = true;
+    changes_ = response->changes;
+    return {reinterpret_cast<const double*>(slot + service_padded(sizeof(ServiceSlotHeader))), response->cols};
+}
+
+
+inline int ServiceClient::changes() const {
+    return changes_;
+}
+
+
+template<typename MatrixType, typename LowerType, typename UpperType, typename BreaksType>
+Eigen::VectorXd ServiceClient::solve(const MatrixType& matrix,
+                                     const LowerType& lower,
+                                     const UpperType& upper,
+                                     const BreaksType& breaks) {
+    auto problem    = request(matrix.rows(), matrix.cols(), breaks.size());
+    problem.matrix  = matrix;
+    problem.lower   = lower;
+    problem.upper   = upper;
+    problem.breaks  = breaks.template cast<std::int32_t>();
+    submit();
+    return receive();
+}
+
+}  // namespace hqp
+
+#endif  // HQP_SERVICE_TPP
@@ -12,16 +12,43 @@ PYBIND11_MODULE(pyhqp, m) {
 
     using HQPDynamic = hqp::HierarchicalQP<>;
 
+    py::enum_<hqp::Factorization>(m, "Factorization", "Factorization of the active rows of a level")
+        .value("COD", hqp::Factorization::COD)
+        .value("PivotedQR", hqp::Factorization::PivotedQR)
+        .value("QR", hqp::Factorization::QR)
+        .value("LDLT", hqp::Factorization::LDLT);
+
     // --- HierarchicalQP solver ---
     py::class_<HQPDynamic>(m, "HierarchicalQP")
         .def(py::init<int, int>(),
              py::arg("m"), py::arg("n"),
              "Create solver with m constraints and n variables")
 
-        .def("set_metric", &HQPDynamic::set_metric,
+        .def("set_metric",
+             static_cast<void (HQPDynamic::*)(const Eigen::MatrixXd&)>(&HQPDynamic::set_metric),
              py::arg("metric"),
              "Set the metric matrix (must be symmetric positive definite)")
 
+        .def("set_metric_diagonal",
+             static_cast<void (HQPDynamic::*)(const Eigen::VectorXd&)>(&HQPDynamic::set_metric_diagonal),
+             py::arg("diagonal"),
+             "Set a diagonal metric from its (positive) diagonal entries")
+
+        .def("set_metric_factor",
+             static_cast<void (HQPDynamic::*)(const Eigen::MatrixXd&, bool)>(&HQPDynamic::set_metric_factor),
+             py::arg("factor"), py::arg("is_inverse") = false,
+             "Set the metric from its upper Cholesky factor U (metric = U^T U), or from U^-1 if is_inverse")
+
+        .def("set_factorization",
+             static_cast<void (HQPDynamic::*)(int, hqp::Factorization)>(&HQPDynamic::set_factorization),
+             py::arg("level"), py::arg("factorization"),
+             "Set the factorization of a level")
+
+        .def("set_factorization",
+             static_cast<void (HQPDynamic::*)(hqp::Factorization)>(&HQPDynamic::set_factorization),
+             py::arg("factorization"),
+             "Set the factorization of every level")
+
         .def("set_problem",
              static_cast<void (HQPDynamic::*)(const Eigen::MatrixXd&, const Eigen::VectorXd&,
                                               const Eigen::VectorXd&, const Eigen::VectorXi&)>(
@@ -39,7 +66,28 @@ PYBIND11_MODULE(pyhqp, m) {
              "Print active set to stdout")
 
         .def_readwrite("tolerance", &HQPDynamic::tolerance,
-                       "Convergence tolerance");
+                       "Convergence tolerance")
+
+        .def_readwrite("activation_margin", &HQPDynamic::activationMargin,
+                       "Violation, in multiples of the tolerance, needed to activate a constraint")
+
+        .def_readwrite("deactivation_margin", &HQPDynamic::deactivationMargin,
+                       "Wrong-signed dual, in multiples of the tolerance, needed to release a constraint")
+
+        .def_readonly("changes", &HQPDynamic::changes,
+                      "Number of active-set changes in the last solve")
+
+        .def_readonly("cycles", &HQPDynamic::cycles,
+                      "Number of active-set cycles detected in the last solve")
+
+        .def_readwrite("decompose", &HQPDynamic::decompose,
+                       "Solve groups of variables that no row couples as independent sub-hierarchies")
+
+        .def_readwrite("threads", &HQPDynamic::threads,
+                       "Maximum number of threads solving the sub-hierarchies")
+
+        .def_readonly("blocks", &HQPDynamic::blocks,
+                      "Number of sub-hierarchies the last solve was split into, 0 if solved as a whole");
 
     // --- Task data holder ---
     py::class_<hqp::TaskBase, std::shared_ptr<hqp::TaskBase>>(m, "Task")
@@ -75,6 +75,28 @@ def test_metric_setting():
     # This should not raise an exception
     solver.set_metric(metric)
 
+    # Fast paths for diagonal and pre-factored metrics
+    solver.set_metric_diagonal(np.array([2.0, 1.0]))
+    solver.set_metric_factor(np.sqrt(metric))
+    solver.set_metric_factor(np.linalg.inv(np.sqrt(metric)), is_inverse=True)
+
+
+def test_factorization_hints():
+    """Test that every factorization gives the solution of the default one."""
+    A = np.array([[1.0, 1.0, 0.0], [0.0, 1.0, -1.0], [1.0, 0.0, 0.0]])
+    lower = np.array([1.0, 0.0, 0.5])
+    upper = np.array([1.0, 0.0, 0.5])
+    breaks = np.array([2, 3], dtype=np.int32)
+
+    reference = pyhqp.HierarchicalQP(3, 3)
+    reference.set_problem(A, lower, upper, breaks)
+    for factorization in [pyhqp.Factorization.PivotedQR, pyhqp.Factorization.QR, pyhqp.Factorization.LDLT]:
+        solver = pyhqp.HierarchicalQP(3, 3)
+        solver.set_factorization(factorization)
+        solver.set_factorization(0, pyhqp.Factorization.COD)
+        solver.set_problem(A, lower, upper, breaks)
+        assert np.allclose(solver.get_primal(), reference.get_primal(), atol=1e-9)
+
 
 def test_problem_dimensions():
     """Test that the solver handles different problem dimensions."""
@@ -90,6 +112,7 @@ def run_all_tests():
         test_basic_solver_creation,
         test_basic_problem_solving,
         test_metric_setting,
+        test_factorization_hints,
         test_problem_dimensions,
     ]
 
@@ -0,0 +1,195 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <Eigen/Dense>
+#include <hqp/hqp.hpp>
+
+// Seeded random problems in the layout of 04_random_problem: normalized task rows, 30% equalities,
+// and a final level regularizing the primal towards zero.
+void random_problem(int seed, Eigen::MatrixXd& A, Eigen::VectorXd& bl, Eigen::VectorXd& bu, Eigen::VectorXi& breaks) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<> ncols_dist(2, 8);
+    std::uniform_int_distribution<> ntasks_dist(1, 6);
+    std::uniform_int_distribution<> nrows_dist(1, 5);
+    std::uniform_real_distribution<> val_dist(-10.0, 10.0);
+    std::uniform_real_distribution<> bound_dist(-20.0, 20.0);
+    std::uniform_real_distribution<> unit_dist(0.0, 1.0);
+
+    int ncols  = ncols_dist(gen);
+    int ntasks = ntasks_dist(gen);
+    std::vector<int> task_rows(ntasks);
+    int total_rows = 0;
+    for (auto& rows : task_rows) {
+        rows        = nrows_dist(gen);
+        total_rows += rows;
+    }
+
+    A.resize(total_rows + ncols, ncols);
+    bl.resize(total_rows + ncols);
+    bu.resize(total_rows + ncols);
+    breaks.resize(ntasks + 1);
+
+    for (int start = 0, k = 0; k < ntasks; ++k) {
+        for (int row = start; row < start + task_rows[k]; ++row) {
+            for (int col = 0; col < ncols; ++col) {
+                A(row, col) = val_dist(gen);
+            }
+            if (unit_dist(gen) < 0.3) {
+                bl(row) = bu(row) = bound_dist(gen);
+            } else {
+                double lower = bound_dist(gen);
+                double upper = bound_dist(gen);
+                if (lower > upper) {
+                    std::swap(lower, upper);
+                }
+                bl(row) = lower;
+                bu(row) = upper;
+            }
+            double norm  = A.row(row).norm();
+            A.row(row)  /= norm;
+            bl(row)     /= norm;
+            bu(row)     /= norm;
+        }
+        start     += task_rows[k];
+        breaks(k)  = start;
+    }
+    A.bottomRows(ncols).setIdentity();
+    bl.tail(ncols).setZero();
+    bu.tail(ncols).setZero();
+    breaks(ntasks) = total_rows + ncols;
+}
+
+// Squared slack norm of every level, the quantity minimized lexicographically by the solver
+Eigen::VectorXd level_costs(hqp::HierarchicalQP<>& solver, const Eigen::VectorXi& breaks) {
+    auto [slackLow, slackUp] = solver.get_slack();
+    Eigen::VectorXd slack    = slackLow + slackUp;
+    Eigen::VectorXd costs(breaks.size());
+    for (int start = 0, k = 0; k < breaks.size(); start = breaks(k++)) {
+        costs(k) = slack.segment(start, breaks(k) - start).squaredNorm();
+    }
+    return costs;
+}
+
+// Which of two lexicographic cost vectors is smaller, up to a tolerance: -1, 0 or 1
+int lex_compare(const Eigen::VectorXd& lhs, const Eigen::VectorXd& rhs, double tolerance) {
+    for (int k = 0; k < lhs.size(); ++k) {
+        if (lhs(k) < rhs(k) - tolerance) {
+            return -1;
+        }
+        if (lhs(k) > rhs(k) + tolerance) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Level costs of the solver before the hysteresis band, on seeds its first version made worse
+struct Recorded {
+    int seed;
+    std::vector<double> costs;
+};
+
+const std::vector<Recorded> recorded = {
+  {428, {4.4384259275e-31, 6.1629758220e-32, 0.0, 1.6782220360e+00, 6.5650781880e-02, 3.3805734794e+00}},
+  {1043, {1.5099290764e-31, 0.0, 1.1655863289e+00, 6.2301981365e-02, 8.0006057125e+00, 3.2971736241e+00}},
+  {1274, {3.0814879110e-33, 0.0, 1.2253729271e-31, 4.7052623012e-01, 9.0302361963e-01, 8.1796140610e+00}},
+  {1633, {3.0814879110e-33, 6.4196446814e+00, 9.2076535399e-01}},
+  {1706,
+   {7.7037197775e-34, 0.0, 6.9333477998e-33, 2.9163376032e-01, 8.9271254451e-01, 7.3426460641e-01, 2.6589941213e+00}},
+};
+
+int main() {
+    const int problems   = 2000;
+    const int maxChanges = 500;
+    const double tol     = 1e-6;
+
+    long changesSharp = 0, changesHysteresis = 0, cyclesHysteresis = 0;
+    int better = 0, worse = 0, capped = 0;
+
+    Eigen::MatrixXd A;
+    Eigen::VectorXd bl, bu;
+    Eigen::VectorXi breaks;
+    for (int seed = 0; seed < problems; ++seed) {
+        random_problem(seed, A, bl, bu, breaks);
+
+        // No margins: any violation enters and any wrong-signed dual leaves the active set
+        hqp::HierarchicalQP sharp(A.rows(), A.cols());
+        sharp.activationMargin   = 0.0;
+        sharp.deactivationMargin = 0.0;
+        sharp.set_problem(A, bl, bu, breaks);
+        sharp.get_primal();
+
+        // Default hysteresis band
+        hqp::HierarchicalQP hysteresis(A.rows(), A.cols());
+        hysteresis.set_problem(A, bl, bu, breaks);
+        hysteresis.get_primal();
+
+        changesSharp      += sharp.changes;
+        changesHysteresis += hysteresis.changes;
+        cyclesHysteresis  += hysteresis.cycles;
+        capped            += hysteresis.changes >= maxChanges;
+
+        // Lexicographic: a problem is worse as soon as a higher-priority level is worse, whatever the levels below gain
+        switch (lex_compare(level_costs(hysteresis, breaks), level_costs(sharp, breaks), tol)) {
+            case -1: ++better; break;
+            case 1: ++worse; break;
+        }
+    }
+
+    std::cout << "Random corpus of " << problems << " problems" << std::endl;
+    std::cout << "  changes, no margins:            " << changesSharp << std::endl;
+    std::cout << "  changes, hysteresis band:       " << changesHysteresis << std::endl;
+    std::cout << "  cycles detected:                " << cyclesHysteresis << std::endl;
+    std::cout << "  hysteresis lexicographically better / worse: " << better << " / " << worse << std::endl;
+
+    if (capped > 0) {
+        std::cerr << capped << " problems hit the active-set change limit" << std::endl;
+        return 1;
+    }
+    if (changesHysteresis > changesSharp) {
+        std::cerr << "Hysteresis increased the number of active-set changes" << std::endl;
+        return 1;
+    }
+    // Without margins the search also releases rows on round-off duals, which on rare degenerate problems happens to
+    // lead to a better active set
+    if (worse > better || worse > problems / 1000) {
+        std::cerr << "Hysteresis degraded too many solutions" << std::endl;
+        return 1;
+    }
+
+    for (const auto& [seed, costs] : recorded) {
+        random_problem(seed, A, bl, bu, breaks);
+        hqp::HierarchicalQP solver(A.rows(), A.cols());
+        solver.set_problem(A, bl, bu, breaks);
+        solver.get_primal();
+        if (lex_compare(level_costs(solver, breaks), Eigen::Map<const Eigen::VectorXd>(costs.data(), costs.size()), tol) >
+            0) {
+            std::cerr << "Seed " << seed << " is lexicographically worse than before the hysteresis band" << std::endl;
+            return 1;
+        }
+    }
+
+    // The rank threshold follows the scale of the unprojected rows: a level that lies within the tolerance of the span of
+    // the one above must be dropped, not inverted, whatever the scale of its rows
+    Eigen::Vector3d a(1.0, 2.0, 2.0), d(2.0, -2.0, 1.0);
+    a /= 3.0;
+    d /= 3.0;
+    for (double scale : {1e-3, 1.0, 1e3}) {
+        A.resize(5, 3);
+        A.row(0) = a.transpose();
+        A.row(1) = scale * (a + 1e-12 * d).transpose();
+        A.bottomRows(3).setIdentity();
+        bl.resize(5);
+        bl << 1.0, 2.0 * scale, 0.0, 0.0, 0.0;
+        bu     = bl;
+        breaks = Eigen::Vector3i(1, 2, 5);
+
+        hqp::HierarchicalQP solver(A.rows(), A.cols());
+        solver.set_problem(A, bl, bu, breaks);
+        if ((solver.get_primal() - a).norm() > tol) {
+            std::cerr << "A level dependent on the one above was inverted at scale " << scale << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <iostream>
+#include <Eigen/Dense>
+#include <hqp/hqp.hpp>
+
+int main() {
+    // 1. Deep stack behind a full-rank equality level:
+    //    Level 0:        A0 x == b0                  (n rows, uses up all DOFs)
+    //    Levels 1..L:    random violated inequalities
+    //    The lower levels cannot move the primal, so the solver must not touch their active sets.
+    const int n      = 6;
+    const int levels = 2000;
+
+    Eigen::MatrixXd A = Eigen::MatrixXd::Random(n + levels, n);
+    Eigen::VectorXd lower(n + levels), upper(n + levels);
+    Eigen::VectorXd target = Eigen::VectorXd::Random(n);
+    lower.head(n)          = upper.head(n) = A.topRows(n) * target;
+    for (int row = n; row < n + levels; ++row) {
+        double value = A.row(row) * target;
+        lower(row)   = value + 1.0;
+        upper(row)   = value + 2.0;
+    }
+    Eigen::VectorXi breaks(levels + 1);
+    breaks(0) = n;
+    for (int k = 1; k <= levels; ++k) {
+        breaks(k) = n + k;
+    }
+
+    hqp::HierarchicalQP solver(A.rows(), A.cols());
+    solver.set_problem(A, lower, upper, breaks);
+    auto t0            = std::chrono::steady_clock::now();
+    Eigen::VectorXd x  = solver.get_primal();
+    double elapsed     = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Deep stack: " << levels << " saturated levels solved in " << elapsed
+              << " us (changes=" << solver.changes << ")" << std::endl;
+
+    if (!x.isApprox(target, 1e-8)) {
+        std::cerr << "Deep stack: wrong primal" << std::endl;
+        return 1;
+    }
+    if (solver.changes != 0) {
+        std::cerr << "Deep stack: saturated levels changed the active set " << solver.changes << " times" << std::endl;
+        return 1;
+    }
+
+    // Slacks of the saturated levels are still reported
+    auto [slackLow, slackUp] = solver.get_slack();
+    if ((slackLow.tail(levels).array() > -1.0 + 1e-8).any()) {
+        std::cerr << "Deep stack: wrong slacks of the saturated levels" << std::endl;
+        return 1;
+    }
+
+    // 2. A free inequality that saturates the DOFs must still be released for a lower level:
+    //    Level 0:  x <= 1
+    //    Level 1:  x == 2, then x == 0 warm-started from the first solution (x <= 1 active)
+    Eigen::MatrixXd B(2, 1);
+    B << 1, 1;
+    Eigen::VectorXd low(2), up(2);
+    low << -1e9, 2;
+    up << 1, 2;
+    Eigen::VectorXi br(2);
+    br << 1, 2;
+
+    hqp::HierarchicalQP warm(B.rows(), B.cols());
+    warm.set_problem(B, low, up, br);
+    if (std::abs(warm.get_primal()(0) - 1.0) > 1e-9) {
+        std::cerr << "Bounded level: wrong primal " << warm.get_primal()(0) << std::endl;
+        return 1;
+    }
+    low(1) = up(1) = 0;
+    warm.set_problem(B, low, up, br);
+    if (std::abs(warm.get_primal()(0)) > 1e-9) {
+        std::cerr << "Released bound: wrong primal " << warm.get_primal()(0) << std::endl;
+        return 1;
+    }
+
+    std::cout << "All saturated level tests passed" << std::endl;
+    return 0;
+}
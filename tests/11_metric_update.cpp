@@ -0,0 +1,87 @@
+#define EIGEN_RUNTIME_NO_MALLOC
+#include <iostream>
+#include <Eigen/Dense>
+#include <hqp/hqp.hpp>
+
+int main() {
+    // Random stack: 2 rows at level 0, 3 rows at level 1. The metric picks the solution among the remaining DOFs.
+    constexpr int n = 6;
+    Eigen::Matrix<double, 5, n> A = Eigen::Matrix<double, 5, n>::Random();
+    Eigen::Vector<double, 5> lower, upper;
+    lower << -0.1, 0.2, 0.5, -1.0, 0.3;
+    upper << -0.1, 0.2, 1.0, -0.5, 0.3;
+    Eigen::Vector2i breaks(2, 5);
+
+    Eigen::Matrix<double, n, n> root   = Eigen::Matrix<double, n, n>::Random();
+    Eigen::Matrix<double, n, n> metric = root * root.transpose() + Eigen::Matrix<double, n, n>::Identity();
+    Eigen::LLT<Eigen::Matrix<double, n, n>> llt(metric);
+    Eigen::Matrix<double, n, n> factor  = llt.matrixU();
+    Eigen::Matrix<double, n, n> inverse = factor.inverse();
+
+    // 1. Dense metric, its Cholesky factor and its inverse factor give the same solution
+    hqp::HierarchicalQP dense(A.rows(), A.cols());
+    dense.set_metric(metric);
+    dense.set_problem(A, lower, upper, breaks);
+    Eigen::VectorXd reference = dense.get_primal();
+
+    hqp::HierarchicalQP fromFactor(A.rows(), A.cols());
+    fromFactor.set_metric_factor(factor);
+    fromFactor.set_problem(A, lower, upper, breaks);
+
+    hqp::HierarchicalQP fromInverse(A.rows(), A.cols());
+    fromInverse.set_metric_factor(inverse, true);
+    fromInverse.set_problem(A, lower, upper, breaks);
+
+    std::cout << "Dense metric:   " << reference.transpose() << std::endl;
+    std::cout << "Factor:         " << fromFactor.get_primal().transpose() << std::endl;
+    std::cout << "Inverse factor: " << fromInverse.get_primal().transpose() << std::endl;
+    if (!fromFactor.get_primal().isApprox(reference, 1e-8) || !fromInverse.get_primal().isApprox(reference, 1e-8)) {
+        std::cerr << "Pre-factored metric disagrees with the dense metric" << std::endl;
+        return 1;
+    }
+
+    // 2. The diagonal fast path matches the same diagonal passed as a dense metric
+    Eigen::Vector<double, n> diagonal = Eigen::Vector<double, n>::Random().cwiseAbs().array() + 0.5;
+    hqp::HierarchicalQP diagonalDense(A.rows(), A.cols());
+    diagonalDense.set_metric(Eigen::Matrix<double, n, n>(diagonal.asDiagonal()));
+    diagonalDense.set_problem(A, lower, upper, breaks);
+    hqp::HierarchicalQP scaled(A.rows(), A.cols());
+    scaled.set_metric_diagonal(diagonal);
+    scaled.set_problem(A, lower, upper, breaks);
+    std::cout << "Diagonal:       " << scaled.get_primal().transpose() << std::endl;
+    if (!scaled.get_primal().isApprox(diagonalDense.get_primal(), 1e-8)) {
+        std::cerr << "Diagonal metric disagrees with the dense metric" << std::endl;
+        return 1;
+    }
+    if (scaled.get_primal().isApprox(reference, 1e-3)) {
+        std::cerr << "Metric has no effect on the solution" << std::endl;
+        return 1;
+    }
+
+    // 3. Per-tick metric updates of a fixed-size solver do not allocate
+    hqp::HierarchicalQP<5, n> fixed(A.rows(), A.cols());
+    fixed.set_problem(A, lower, upper, breaks);
+    Eigen::internal::set_is_malloc_allowed(false);
+    fixed.set_metric(metric);
+    fixed.set_metric_factor(factor);
+    fixed.set_metric_factor(inverse, true);
+    fixed.set_metric_diagonal(diagonal);
+    Eigen::internal::set_is_malloc_allowed(true);
+
+    // 4. Invalid metrics are rejected
+    try {
+        scaled.set_metric_diagonal(-diagonal);
+        std::cerr << "Negative diagonal metric accepted" << std::endl;
+        return 1;
+    } catch (const std::invalid_argument&) {
+    }
+    try {
+        scaled.set_metric_factor(-factor);
+        std::cerr << "Factor with a negative diagonal accepted" << std::endl;
+        return 1;
+    } catch (const std::invalid_argument&) {
+    }
+
+    std::cout << "All metric update tests passed" << std::endl;
+    return 0;
+}
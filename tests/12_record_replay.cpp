@@ -0,0 +1,121 @@
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <Eigen/Dense>
+#include <hqp/hqp.hpp>
+#include <record/record.hpp>
+#include <task/task.hpp>
+
+int main() {
+    // Time-varying problem: 4 variables, box at level 0, a moving target at level 1, a dense metric
+    //   Level 0:  -1 <= x_i <= 1
+    //   Level 1:  x1 + x2 == sin(t), 0 <= x3 - x4 <= cos(t)
+    //   Level 2:  x == 0.5
+    const int ticks = 50;
+    Eigen::MatrixXd A(10, 4);
+    A << Eigen::MatrixXd::Identity(4, 4), 1, 1, 0, 0, 0, 0, 1, -1, Eigen::MatrixXd::Identity(4, 4);
+    Eigen::VectorXd lower(10), upper(10);
+    Eigen::VectorXi breaks(3);
+    breaks << 4, 6, 10;
+    Eigen::MatrixXd metric = Eigen::MatrixXd::Identity(4, 4);
+    metric(0, 1) = metric(1, 0) = 0.3;
+
+    auto path = (std::filesystem::temp_directory_path() / "hqp_12_record_replay.log").string();
+    std::vector<Eigen::VectorXd> primals;
+    std::vector<int> changes;
+    {
+        hqp::LogWriter writer(path);
+        hqp::HierarchicalQP solver(A.rows(), A.cols());
+        solver.set_metric(metric);
+        solver.set_recorder(&writer);
+        for (int tick = 0; tick < ticks; ++tick) {
+            double t = 0.2 * tick;
+            lower << -Eigen::VectorXd::Ones(4), 3 * std::sin(t), 0, Eigen::VectorXd::Constant(4, 0.5);
+            upper << Eigen::VectorXd::Ones(4), 3 * std::sin(t), std::cos(t), Eigen::VectorXd::Constant(4, 0.5);
+            lower(5) = std::min(0.0, std::cos(t));
+            solver.set_problem(A, lower, upper, breaks);
+            primals.push_back(solver.get_primal());
+            changes.push_back(solver.changes);
+        }
+        solver.set_recorder(nullptr);
+
+        // A stack of tasks without solver state
+        hqp::StackOfTasks sot;
+        sot.set_stack(A, lower, upper, breaks);
+        writer.record_stack(sot);
+        writer.flush();
+
+        if (writer.dropped() != 0) {
+            std::cerr << "Records dropped: " << writer.dropped() << std::endl;
+            return 1;
+        }
+    }
+
+    // 1. Every tick replays to the same solution with the same number of active-set changes
+    {
+        hqp::LogReader log(path);
+        if (log.size() != ticks + 1) {
+            std::cerr << "Expected " << ticks + 1 << " records, found " << log.size() << std::endl;
+            return 1;
+        }
+        for (int tick = 0; tick < ticks; ++tick) {
+            hqp::HierarchicalQP replay(A.rows(), A.cols());
+            log.restore(tick, replay);
+            if (log[tick].header->sequence != static_cast<std::uint64_t>(tick) ||
+                !replay.get_primal().isApprox(primals[tick]) || replay.changes != changes[tick]) {
+                std::cerr << "Tick " << tick << " replays to " << replay.get_primal().transpose() << " ("
+                          << replay.changes << " changes) instead of " << primals[tick].transpose() << " ("
+                          << changes[tick] << " changes)" << std::endl;
+                return 1;
+            }
+        }
+        std::cout << "Replayed " << ticks << " ticks" << std::endl;
+
+        auto stack = log[ticks];
+        if (stack.header->flags != 0 || !stack.matrix.isApprox(A) || stack.guess.size() != 0) {
+            std::cerr << "Wrong stack record" << std::endl;
+            return 1;
+        }
+    }
+
+    // 2. A record cut short by a crash is ignored
+    auto size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size - 8);
+    {
+        hqp::LogReader log(path);
+        if (log.size() != ticks) {
+            std::cerr << "Truncated log: expected " << ticks << " records, found " << log.size() << std::endl;
+            return 1;
+        }
+    }
+
+    // 3. A record whose dimensions do not add up to its size is rejected, not read past its end
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        std::int32_t rows = A.rows() + 1;
+        file.seekp(sizeof(hqp::LogFileHeader) + offsetof(hqp::LogRecordHeader, rows));
+        file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+    }
+    try {
+        hqp::LogReader log(path);
+        std::cerr << "Record with inconsistent dimensions accepted" << std::endl;
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+
+    // 4. Anything else is rejected
+    std::ofstream(path, std::ios::binary) << "not a log file at all, but long enough to hold a header";
+    try {
+        hqp::LogReader log(path);
+        std::cerr << "Invalid log accepted" << std::endl;
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+    std::filesystem::remove(path);
+
+    std::cout << "All record/replay tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <iostream>
+#include <Eigen/Dense>
+#include <hqp/hqp.hpp>
+#include <task/task.hpp>
+#include "compiled_stack.hpp"
+
+int main() {
+#ifndef HQP_COMPILED
+    std::cerr << "Not linked against HQP::hqp_compiled" << std::endl;
+    return 1;
+#endif
+
+    // Stack solved here and in compiled_stack.cpp: both translation units include the solver and task headers
+    //   Level 0:  x1 + x2 <= 1
+    //   Level 1:  x1 == 2, x2 == 1
+    Eigen::MatrixXd A(3, 2);
+    A << 1, 1, 1, 0, 0, 1;
+    Eigen::VectorXd lower(3), upper(3);
+    lower << -1e9, 2, 1;
+    upper << 1, 2, 1;
+    Eigen::VectorXi breaks(2);
+    breaks << 1, 3;
+
+    hqp::StackOfTasks sot;
+    sot.set_stack(A, lower, upper, breaks);
+    auto [matrix, lb, ub, br] = sot.get_stack();
+    hqp::HierarchicalQP solver(matrix.rows(), matrix.cols());
+    solver.set_metric_diagonal(Eigen::VectorXd::Ones(2));
+    solver.set_problem(matrix, lb, ub, br);
+
+    Eigen::VectorXd expected(2);
+    expected << 1, 0;
+    Eigen::VectorXd other = solve_stack(A, lower, upper, breaks);
+    std::cout << "Primal: " << solver.get_primal().transpose() << std::endl;
+    if (!solver.get_primal().isApprox(expected, 1e-9) || !other.isApprox(expected, 1e-9)) {
+        std::cerr << "Expected " << expected.transpose() << ", got " << solver.get_primal().transpose() << " and "
+                  << other.transpose() << std::endl;
+        return 1;
+    }
+
+    std::cout << "All compiled library tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <random>
+#include <Eigen/Dense>
+#include <hqp/hqp.hpp>
+
+// Random stack: `levels` levels of `rows` normalized rows over `cols` variables, 30% equalities, then x == 0
+void random_problem(int seed, int levels, int rows, int cols, Eigen::MatrixXd& A, Eigen::VectorXd& bl,
+                    Eigen::VectorXd& bu, Eigen::VectorXi& breaks) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<> val_dist(-10.0, 10.0);
+    std::uniform_real_distribution<> bound_dist(-20.0, 20.0);
+    std::uniform_real_distribution<> unit_dist(0.0, 1.0);
+
+    A.resize(levels * rows + cols, cols);
+    bl.resize(A.rows());
+    bu.resize(A.rows());
+    breaks.resize(levels + 1);
+    for (int row = 0; row < levels * rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            A(row, col) = val_dist(gen);
+        }
+        double lower = bound_dist(gen), upper = bound_dist(gen);
+        if (unit_dist(gen) < 0.3) {
+            upper = lower;
+        } else if (lower > upper) {
+            std::swap(lower, upper);
+        }
+        double norm  = A.row(row).norm();
+        A.row(row)  /= norm;
+        bl(row)      = lower / norm;
+        bu(row)      = upper / norm;
+    }
+    for (int k = 0; k < levels; ++k) breaks(k) = (k + 1) * rows;
+    A.bottomRows(cols).setIdentity();
+    bl.tail(cols).setZero();
+    bu.tail(cols).setZero();
+    breaks(levels) = A.rows();
+}
+
+int main() {
+    const hqp::Factorization methods[] = {
+      hqp::Factorization::PivotedQR, hqp::Factorization::QR, hqp::Factorization::LDLT};
+    const char* names[] = {"PivotedQR", "QR", "LDLT"};
+
+    // 1. Every factorization reaches the solution of COD, whatever the rank of the levels
+    Eigen::MatrixXd A;
+    Eigen::VectorXd bl, bu;
+    Eigen::VectorXi breaks;
+    for (int seed = 0; seed < 300; ++seed) {
+        random_problem(seed, 1 + seed % 4, 1 + seed % 5, 2 + seed % 7, A, bl, bu, breaks);
+        if (seed % 3 == 0) {
+            A.row(1) = A.row(0);  // rank deficient first level
+        } else if (seed % 3 == 1) {
+            // Without the regularization, the last level is a task that leaves DOFs free
+            int rows = breaks(breaks.size() - 2);
+            A.conservativeResize(rows, Eigen::NoChange);
+            bl.conservativeResize(rows);
+            bu.conservativeResize(rows);
+            breaks.conservativeResize(breaks.size() - 1);
+        }
+        hqp::HierarchicalQP reference(A.rows(), A.cols());
+        reference.set_problem(A, bl, bu, breaks);
+        for (int i = 0; i < 3; ++i) {
+            hqp::HierarchicalQP solver(A.rows(), A.cols());
+            solver.set_factorization(methods[i]);
+            solver.set_problem(A, bl, bu, breaks);
+            if (!solver.get_primal().isApprox(reference.get_primal(), 1e-6)) {
+                std::cerr << names[i] << " on problem " << seed << ": " << solver.get_primal().transpose()
+                          << " instead of " << reference.get_primal().transpose() << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // 2. Per-level hints, with a dense metric, and kept over warm-started solves
+    random_problem(7, 3, 2, 6, A, bl, bu, breaks);
+    Eigen::MatrixXd root   = Eigen::MatrixXd::Random(6, 6);
+    Eigen::MatrixXd metric = root * root.transpose() + Eigen::MatrixXd::Identity(6, 6);
+    hqp::HierarchicalQP reference(A.rows(), A.cols());
+    hqp::HierarchicalQP mixed(A.rows(), A.cols());
+    reference.set_metric(metric);
+    mixed.set_metric(metric);
+    mixed.set_factorization(0, hqp::Factorization::QR);
+    mixed.set_factorization(1, hqp::Factorization::PivotedQR);
+    mixed.set_factorization(3, hqp::Factorization::LDLT);
+    for (int tick = 0; tick < 10; ++tick) {
+        bl.head(6).array() += 0.1;
+        bu.head(6).array() += 0.1;
+        reference.set_problem(A, bl, bu, breaks);
+        mixed.set_problem(A, bl, bu, breaks);
+        if (!mixed.get_primal().isApprox(reference.get_primal(), 1e-6)) {
+            std::cerr << "Per-level hints at tick " << tick << ": " << mixed.get_primal().transpose()
+                      << " instead of " << reference.get_primal().transpose() << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Per-level hints: " << mixed.get_primal().transpose() << std::endl;
+
+    try {
+        mixed.set_factorization(-1, hqp::Factorization::QR);
+        std::cerr << "Negative level accepted" << std::endl;
+        return 1;
+    } catch (const std::invalid_argument&) {
+    }
+
+    std::cout << "All factorization tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <Eigen/Dense>
+#include <hqp/hqp.hpp>
+#include <service/service.hpp>
+
+struct Problem {
+    Eigen::MatrixXd A;
+    Eigen::VectorXd lower, upper;
+    Eigen::VectorXi breaks;
+};
+
+// Boxed random stack whose bounds drift from one call to the next, as in a control loop
+Problem make_problem(std::mt19937& rng, int step) {
+    std::normal_distribution<double> normal;
+    int n = 6;
+    Problem p;
+    p.A      = Eigen::MatrixXd::Zero(n + 6, n);
+    p.lower  = Eigen::VectorXd(n + 6);
+    p.upper  = Eigen::VectorXd(n + 6);
+    p.breaks = Eigen::VectorXi(3);
+    p.A.topRows(n).setIdentity();
+    p.lower.head(n).setConstant(-1);
+    p.upper.head(n).setConstant(1);
+    for (int i = n; i < n + 6; ++i) {
+        for (int j = 0; j < n; ++j) {
+            p.A(i, j) = normal(rng);
+        }
+        double b   = 2 * normal(rng) + 0.1 * step;
+        p.lower(i) = i < n + 3 ? b : -1e9;
+        p.upper(i) = b;
+    }
+    p.breaks << n, n + 3, n + 6;
+    return p;
+}
+
+// Solves the same sequence through the service and through a local solver; both warm-start the same way
+int client(const std::string& name, int seed) {
+    hqp::ServiceClient remote(name, 10.0);
+    hqp::HierarchicalQP local(12, 6);
+    std::mt19937 rng(seed);
+    for (int step = 0; step < 50; ++step) {
+        Problem p         = make_problem(rng, step);
+        Eigen::VectorXd x = remote.solve(p.A, p.lower, p.upper, p.breaks);
+        local.set_problem(p.A, p.lower, p.upper, p.breaks);
+        if ((x - local.get_primal()).norm() > 1e-12 || remote.changes() != local.changes) {
+            std::cerr << "Client " << seed << " step " << step << " disagrees with the local solver" << std::endl;
+            return 1;
+        }
+    }
+
+    // Two requests in flight, received in order
+    std::mt19937 pipelined(seed + 100);
+    Problem first = make_problem(pipelined, 0), second = make_problem(pipelined, 1);
+    for (const Problem* p : {&first, &second}) {
+        auto slot   = remote.request(p->A.rows(), p->A.cols(), p->breaks.size(), true);
+        slot.matrix = p->A;
+        slot.lower  = p->lower;
+        slot.upper  = p->upper;
+        slot.breaks = p->breaks;
+        remote.submit();
+    }
+    for (const Problem* p : {&first, &second}) {
+        auto x = remote.receive();
+        hqp::HierarchicalQP cold(12, 6);
+        cold.set_problem(p->A, p->lower, p->upper, p->breaks);
+        if ((x - cold.get_primal()).norm() > 1e-12) {
+            std::cerr << "Client " << seed << " pipelined request disagrees with a cold solver" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main() {
+    std::string name = "/hqp_test_" + std::to_string(::getpid());
+
+    // 1. Clients in other processes, started before the service comes up
+    std::vector<pid_t> children;
+    for (int seed = 1; seed <= 3; ++seed) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ::_exit(client(name, seed));
+        }
+        children.push_back(pid);
+    }
+
+    hqp::ServiceOptions options;
+    options.channels  = 4;
+    options.maxRows   = 16;
+    options.maxCols   = 8;
+    options.maxLevels = 4;
+    options.threads   = 2;
+    auto service      = std::make_unique<hqp::SolverService>(name, options);
+
+    bool failed = false;
+    for (pid_t pid : children) {
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    if (failed) {
+        std::cerr << "A client process failed" << std::endl;
+        return 1;
+    }
+    std::cout << "3 client processes match their local solvers" << std::endl;
+
+    // 2. Errors: oversized problems are refused, invalid ones fail on the service and leave the channel usable
+    hqp::ServiceClient client(name);
+    try {
+        client.request(17, 6, 1);
+        std::cerr << "Oversized request accepted" << std::endl;
+        return 1;
+    } catch (const std::invalid_argument&) {
+    }
+    Eigen::MatrixXd A = Eigen::MatrixXd::Identity(2, 2);
+    Eigen::Vector2d lower(1, 2), upper(0, 2);
+    Eigen::VectorXi breaks(1);
+    breaks << 2;
+    try {
+        client.solve(A, lower, upper, breaks);
+        std::cerr << "Invalid bounds solved" << std::endl;
+        return 1;
+    } catch (const std::runtime_error& error) {
+        std::cout << "Failed request: " << error.what() << std::endl;
+    }
+    lower(0) = 0;
+    if (!client.solve(A, lower, upper, breaks).isApprox(Eigen::Vector2d(0, 2))) {
+        std::cerr << "Channel unusable after a failed request" << std::endl;
+        return 1;
+    }
+
+    // 3. Stopping the service fails the requests still waiting
+    client.request(2, 2, 1);
+    service.reset();
+    client.submit();
+    try {
+        client.receive();
+        std::cerr << "Receive succeeded on a stopped service" << std::endl;
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+
+    std::cout << "All shared-memory service tests passed" << std::endl;
+    return 0;
+}
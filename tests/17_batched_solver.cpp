@@ -0,0 +1,112 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <Eigen/Dense>
+#include <batch/batch.hpp>
+#include <hqp/hqp.hpp>
+
+// Random stacks with a box, inequalities that may conflict, an equality and a least-squares level. Every lane is
+// compared with a fresh HierarchicalQP, which returns the same minimum-norm solution.
+template<int Lanes, int ROWS, int COLS>
+int compare(int batches, unsigned seed) {
+    constexpr int LEVS = 4;
+    static_assert(ROWS >= COLS + 4, "Stack needs a box and three more levels");
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> normal;
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    Eigen::Vector<int, LEVS> breaks;
+    breaks << COLS, ROWS - 3, ROWS - 2, ROWS;
+    hqp::BatchedHierarchicalQP<Lanes, ROWS, COLS, LEVS> batch(breaks);
+
+    int mismatches = 0;
+    double worst   = 0;
+    for (int b = 0; b < batches; ++b) {
+        std::vector<Eigen::Matrix<double, ROWS, COLS>> matrices(Lanes);
+        std::vector<Eigen::Vector<double, ROWS>> lowers(Lanes), uppers(Lanes);
+        for (int lane = 0; lane < Lanes; ++lane) {
+            auto& A = matrices[lane];
+            auto& l = lowers[lane];
+            auto& u = uppers[lane];
+            A.setZero();
+            A.topRows(COLS).setIdentity();
+            l.head(COLS).setConstant(-1);
+            u.head(COLS).setConstant(1);
+            for (int i = COLS; i < ROWS; ++i) {
+                for (int j = 0; j < COLS; ++j) {
+                    A(i, j) = normal(rng);
+                }
+                double center = 2 * normal(rng);
+                double width  = uniform(rng) < 0.3 ? 0 : uniform(rng);
+                l(i)          = center - width;
+                u(i)          = uniform(rng) < 0.2 ? 1e9 : center + width;
+            }
+            // Some lanes repeat a row of a level with other bounds, so the level cannot be satisfied
+            if (uniform(rng) < 0.3) {
+                A.row(COLS + 1) = A.row(COLS);
+                l(COLS + 1)     = u(COLS) + 1;
+                u(COLS + 1)     = std::max(u(COLS + 1), l(COLS + 1));
+            }
+            l(ROWS - 3) = u(ROWS - 3);
+            batch.set_problem(lane, A, l, u);
+        }
+        batch.solve();
+
+        for (int lane = 0; lane < Lanes; ++lane) {
+            hqp::HierarchicalQP<> reference(ROWS, COLS);
+            reference.set_problem(matrices[lane], lowers[lane], uppers[lane], breaks);
+            double error = (batch.get_primal(lane) - reference.get_primal()).norm();
+            worst        = std::max(worst, error);
+            if (!(error < 1e-6)) {
+                ++mismatches;
+                std::cerr << "Batch " << b << " lane " << lane << ": " << batch.get_primal(lane).transpose()
+                          << " vs " << reference.get_primal().transpose() << std::endl;
+            }
+        }
+    }
+    std::cout << Lanes << " lanes, " << ROWS << "x" << COLS << ": " << batches * Lanes << " problems, " << mismatches
+              << " mismatches, largest difference " << worst << std::endl;
+    return mismatches;
+}
+
+
+int main() {
+    int mismatches = compare<4, 7, 3>(100, 1) + compare<8, 14, 7>(100, 2) + compare<16, 10, 6>(50, 3);
+    if (mismatches > 0) {
+        return 1;
+    }
+
+    // Lanes warm-started from their previous active set give the same solution with fewer changes
+    Eigen::Vector<int, 2> breaks(3, 5);
+    hqp::BatchedHierarchicalQP<4, 5, 3, 2> batch(breaks);
+    Eigen::Matrix<double, 5, 3> A;
+    A << Eigen::Matrix3d::Identity(), 1, 1, 1, 1, -1, 0;
+    Eigen::Vector<double, 5> lower(-1, -1, -1, 5, -2), upper(1, 1, 1, 5, 2);
+    for (int lane = 0; lane < 4; ++lane) {
+        upper(4) = 0.5 * lane;
+        batch.set_problem(lane, A, lower, upper);
+    }
+    batch.solve();
+    Eigen::Vector<double, 3> cold = batch.get_primal(0);
+    int coldChanges               = batch.changes(0);
+    batch.solve();
+    if (!batch.get_primal(0).isApprox(cold) || batch.changes(0) != 0 || coldChanges == 0) {
+        std::cerr << "Warm start: " << batch.changes(0) << " changes after " << coldChanges << std::endl;
+        return 1;
+    }
+    if (!cold.isApprox(Eigen::Vector3d(1, 1, 1))) {
+        std::cerr << "Saturated box: " << cold.transpose() << std::endl;
+        return 1;
+    }
+
+    try {
+        batch.lower(0)(2) = 2;
+        batch.solve();
+        std::cerr << "Crossed bounds accepted" << std::endl;
+        return 1;
+    } catch (const std::invalid_argument&) {
+    }
+
+    std::cout << "All batched solver tests passed" << std::endl;
+    return 0;
+}
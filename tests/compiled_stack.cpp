@@ -0,0 +1,16 @@
+#include "compiled_stack.hpp"
+#include <hqp/hqp.hpp>
+#include <task/task.hpp>
+
+Eigen::VectorXd solve_stack(Eigen::MatrixXd const& matrix,
+                            Eigen::VectorXd const& lower,
+                            Eigen::VectorXd const& upper,
+                            Eigen::VectorXi const& breaks) {
+    hqp::StackOfTasks sot;
+    sot.set_stack(matrix, lower, upper, breaks);
+    auto [A, lb, ub, br] = sot.get_stack();
+
+    hqp::HierarchicalQP solver(A.rows(), A.cols());
+    solver.set_problem(A, lb, ub, br);
+    return solver.get_primal();
+}
@@ -0,0 +1,12 @@
+#ifndef _CompiledStack_
+#define _CompiledStack_
+
+#include <Eigen/Dense>
+
+// Solves a stack of tasks in a translation unit of its own, so that test 13 links two users of the headers.
+Eigen::VectorXd solve_stack(Eigen::MatrixXd const& matrix,
+                            Eigen::VectorXd const& lower,
+                            Eigen::VectorXd const& upper,
+                            Eigen::VectorXi const& breaks);
+
+#endif  // _CompiledStack_
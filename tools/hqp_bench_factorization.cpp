@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include <hqp/hqp.hpp>
+
+// Times the factorizations of HierarchicalQP on equality stacks of various shapes.
+//
+//   hqp_bench_factorization [--repeat N]
+//
+// Every scenario is a stack of `levels` levels of `rows` random equality rows over `cols` variables, optionally made
+// rank deficient by repeating a row in every level. The median time of N solves is reported for each factorization.
+struct Scenario {
+    std::string name;
+    int levels;
+    int rows;
+    int cols;
+    bool deficient;
+};
+
+int main(int argc, char** argv) {
+    int repeat = 200;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::stoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--repeat N]" << std::endl;
+            return 2;
+        }
+    }
+
+    const std::vector<Scenario> scenarios = {
+      {"few rows, many DOFs", 3, 3, 60, false},
+      {"many small levels", 10, 4, 48, false},
+      {"single wide task", 1, 20, 120, false},
+      {"levels filling the DOFs", 4, 10, 40, false},
+      {"rank deficient levels", 3, 6, 30, true},
+    };
+    const hqp::Factorization methods[] = {
+      hqp::Factorization::COD, hqp::Factorization::PivotedQR, hqp::Factorization::QR, hqp::Factorization::LDLT};
+
+    std::cout << std::left << std::setw(26) << "scenario" << std::right << std::setw(10) << "COD" << std::setw(11)
+              << "PivotedQR" << std::setw(10) << "QR" << std::setw(10) << "LDLT" << "   [us, median]" << std::endl;
+    std::mt19937 gen(0);
+    std::normal_distribution<> dist;
+    for (const auto& scenario : scenarios) {
+        int m = scenario.levels * scenario.rows;
+        Eigen::MatrixXd A(m, scenario.cols);
+        Eigen::VectorXd bounds(m);
+        Eigen::VectorXi breaks(scenario.levels);
+        for (int row = 0; row < m; ++row) {
+            for (int col = 0; col < scenario.cols; ++col) A(row, col) = dist(gen);
+            bounds(row) = dist(gen);
+        }
+        for (int k = 0; k < scenario.levels; ++k) {
+            breaks(k) = (k + 1) * scenario.rows;
+            if (scenario.deficient) {
+                A.row(k * scenario.rows + 1)    = A.row(k * scenario.rows);
+                bounds(k * scenario.rows + 1) = bounds(k * scenario.rows);
+            }
+        }
+
+        std::cout << std::left << std::setw(26) << scenario.name << std::right;
+        for (auto method : methods) {
+            hqp::HierarchicalQP solver(m, scenario.cols);
+            solver.set_factorization(method);
+            std::vector<double> times(repeat);
+            for (auto& time : times) {
+                solver.set_problem(A, bounds, bounds, breaks);
+                auto start = std::chrono::steady_clock::now();
+                solver.get_primal();
+                auto stop = std::chrono::steady_clock::now();
+                time      = std::chrono::duration<double, std::micro>(stop - start).count();
+            }
+            std::nth_element(times.begin(), times.begin() + repeat / 2, times.end());
+            std::cout << std::setw(method == hqp::Factorization::PivotedQR ? 11 : 10) << std::fixed
+                      << std::setprecision(1) << times[repeat / 2];
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sys/mman.h>
+#include <hqp/hqp.hpp>
+#include <service/service.hpp>
+
+// Serves solve requests of local processes through shared memory until interrupted.
+//
+//   hqp_daemon [--name /hqp] [--clients N] [--depth N] [--rows N] [--cols N] [--levels N] [--threads N]
+//              [--cores 2,3] [--force]
+//
+// Clients attach with hqp::ServiceClient(name). --force removes a segment left by a daemon that was killed.
+namespace {
+std::atomic<bool> interrupted{false};
+
+void interrupt(int) {
+    interrupted = true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string name = "/hqp";
+    bool force       = false;
+    hqp::ServiceOptions options;
+    for (int i = 1; i < argc; ++i) {
+        bool value = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--name") && value) {
+            name = argv[++i];
+        } else if (!std::strcmp(argv[i], "--clients") && value) {
+            options.channels = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--depth") && value) {
+            options.depth = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--rows") && value) {
+            options.maxRows = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--cols") && value) {
+            options.maxCols = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--levels") && value) {
+            options.maxLevels = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--threads") && value) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--cores") && value) {
+            std::stringstream cores(argv[++i]);
+            for (std::string core; std::getline(cores, core, ',');) {
+                options.cores.push_back(std::atoi(core.c_str()));
+            }
+        } else if (!std::strcmp(argv[i], "--force")) {
+            force = true;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--name /hqp] [--clients N] [--depth N] [--rows N] [--cols N] [--levels N] [--threads N]"
+                         " [--cores 2,3] [--force]"
+                      << std::endl;
+            return 2;
+        }
+    }
+
+    std::signal(SIGINT, interrupt);
+    std::signal(SIGTERM, interrupt);
+    if (force) {
+        ::shm_unlink(name.c_str());
+    }
+    try {
+        hqp::SolverService service(name, options);
+        std::cout << "Serving " << options.channels << " clients on " << name << " with " << options.threads
+                  << " threads (up to " << options.maxRows << " rows, " << options.maxCols << " cols, "
+                  << options.maxLevels << " levels)" << std::endl;
+        while (!interrupted) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include <hqp/hqp.hpp>
+#include <record/record.hpp>
+
+// Streams a recorded session back through the solver and reports the solve time of every tick.
+//
+//   hqp_replay <log> [--repeat N] [--quiet] [--factorization cod|pivoted-qr|qr|ldlt]
+//
+// Each tick is restored with its recorded metric, settings and warm start, then solved `N` times; the fastest solve
+// is reported. Factorization hints are not recorded: every level uses the one given on the command line (COD by
+// default). Records written by LogWriter::record_stack() carry no warm start: they are solved from the state left
+// by the previous solve, as a solver reused across ticks would be.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <log> [--repeat N] [--quiet] [--factorization cod|pivoted-qr|qr|ldlt]"
+                  << std::endl;
+        return 2;
+    }
+    std::string path   = argv[1];
+    int repeat         = 1;
+    bool quiet         = false;
+    auto factorization = hqp::Factorization::COD;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--repeat") && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--quiet")) {
+            quiet = true;
+        } else if (!std::strcmp(argv[i], "--factorization") && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "cod") {
+                factorization = hqp::Factorization::COD;
+            } else if (name == "pivoted-qr") {
+                factorization = hqp::Factorization::PivotedQR;
+            } else if (name == "qr") {
+                factorization = hqp::Factorization::QR;
+            } else if (name == "ldlt") {
+                factorization = hqp::Factorization::LDLT;
+            } else {
+                std::cerr << "Unknown factorization " << name << std::endl;
+                return 2;
+            }
+        } else {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return 2;
+        }
+    }
+
+    try {
+        hqp::LogReader log(path);
+        std::unique_ptr<hqp::HierarchicalQP<>> solver;
+        std::vector<double> times;
+        times.reserve(log.size());
+        long changes = 0;
+        int rows = -1, cols = -1;
+
+        if (!quiet) {
+            std::cout << std::setw(8) << "tick" << std::setw(8) << "rows" << std::setw(6) << "cols" << std::setw(8)
+                      << "levels" << std::setw(9) << "changes" << std::setw(12) << "time [us]" << std::endl;
+        }
+        for (std::size_t tick = 0; tick < log.size(); ++tick) {
+            const hqp::LogRecordHeader& header = *log[tick].header;
+            if (header.rows != rows || header.cols != cols) {
+                rows   = header.rows;
+                cols   = header.cols;
+                solver = std::make_unique<hqp::HierarchicalQP<>>(rows, cols);
+                solver->set_factorization(factorization);
+            }
+
+            double best = std::numeric_limits<double>::infinity();
+            for (int r = 0; r < repeat; ++r) {
+                log.restore(tick, *solver);
+                auto start = std::chrono::steady_clock::now();
+                solver->get_primal();
+                auto stop = std::chrono::steady_clock::now();
+                best      = std::min(best, std::chrono::duration<double, std::micro>(stop - start).count());
+            }
+            times.push_back(best);
+            changes += solver->changes;
+
+            if (!quiet) {
+                std::cout << std::setw(8) << header.sequence << std::setw(8) << header.rows << std::setw(6)
+                          << header.cols << std::setw(8) << header.levels << std::setw(9) << solver->changes
+                          << std::setw(12) << std::fixed << std::setprecision(2) << best << std::endl;
+            }
+        }
+
+        if (times.empty()) {
+            std::cout << "Empty log" << std::endl;
+            return 0;
+        }
+        std::vector<double> sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (double time : times) total += time;
+        auto percentile = [&sorted](double p) {
+            return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))];
+        };
+        std::cout << std::fixed << std::setprecision(2) << times.size() << " ticks, " << changes
+                  << " active-set changes: mean " << total / times.size() << " us, median " << percentile(0.5)
+                  << " us, p99 " << percentile(0.99) << " us, max " << sorted.back() << " us" << std::endl;
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}